@@ -1,19 +1,29 @@
 #include "AppConfig.hpp"
 #include "BleServer.hpp"
+#include "BootProfiler.hpp"
+#include "ConfigNotifier.hpp"
+#include "ConfigStore.hpp"
 #include "DS3231.hpp"
 #include "DateTime.hpp"
 #include "HttpServer.hpp"
+#include "IdlePowerManager.hpp"
 #include "MixingStreamer.hpp"
+#include "OsdLayer.hpp"
 #include "RecordingController.hpp"
 #include "Resources.hpp"
+#include "ScheduleProgress.hpp"
+#include "StorageManager.hpp"
+#include "SystemClock.hpp"
 #include "TimeUtil.hpp"
 #include "TrackedValue.hpp"
 #include "WiFiHotspot.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
+#include <cstdio>
 #include <limits>
-#include <memory>
+#include <optional>
 #include <tuple>
 #include <utility>
 
@@ -23,14 +33,17 @@
 #include <VideoStream.h>
 #include <VideoStreamOverlay.h>
 #include <Wire.h>
+#include <module_video.h>
 
 extern BleService& systemInfoService;
 extern BleService& currentScheduleService;
 extern BleService& updateTimeService;
 extern BleService& updateScheduleService;
+extern BleService& bootProfileService;
 
 extern HttpService& fallbackService;
 extern HttpService& videoStreamingService;
+extern HttpService& bootProfileHttpService;
 
 extern MMFModule& videoStreamingMMFModule;
 
@@ -38,155 +51,322 @@ namespace {
     constexpr auto noPendingValue = std::numeric_limits<int32_t>::min();
 }
 
-std::atomic_int32_t globalNowSince2020{0};
 std::atomic_int32_t globalPendingTimestampSince2020{noPendingValue};
 
-QueueHandle_t globalAppMutex;
+TaskHandle_t globalMainTask;
 
 namespace {
-    constexpr int32_t videoChannel = 0;
-    constexpr char deviceName[]    = "NINOCAM";
-    constexpr char serviceUuid[]   = "4fafc201-1fb5-459e-8fcc-c5c9c331914b";
-    constexpr char rxUuid[]        = "beb5483e-36e1-4688-b7f5-ea07361b26a8";
-    constexpr char txUuid[]        = "d506d318-2fbc-4d2c-8a67-f14b7313f3df";
-
-    std::shared_ptr<TrackedValue<AppConfig>::ElementPair> appConfigCache;
+    constexpr int32_t videoChannel         = 0;
+    constexpr int32_t videoFrameRate       = 30;              // Frame rate of the FHD preset.
+    constexpr int32_t idleFrameRate        = 5;
+    constexpr uint32_t rtcInterruptPin     = 21;              // DS3231 INT/SQW, also the deep sleep wake source.
+    constexpr uint32_t squareWaveTimeoutMs = 1500;
+    constexpr uint32_t windowWaitLimitMs   = 60 * 1000;
+    constexpr int32_t osdMargin            = 36;
+    constexpr int32_t osdCharWidth         = 30;
+    constexpr int32_t osdCharHeight        = 48;
+    constexpr uint32_t osdTextColor        = 0xFFFFFFFF;
+    constexpr uint32_t osdRecordingColor   = 0xFFFF0000;
+    constexpr uint32_t freeSpaceIntervalMs = 60 * 1000;
+    constexpr char deviceName[]            = "NINOCAM";
+    constexpr char serviceUuid[]           = "4fafc201-1fb5-459e-8fcc-c5c9c331914b";
+    constexpr char rxUuid[]                = "beb5483e-36e1-4688-b7f5-ea07361b26a8";
+    constexpr char txUuid[]                = "d506d318-2fbc-4d2c-8a67-f14b7313f3df";
+
+    TrackedValue<AppConfig>::Snapshot appConfigCache;
+    std::atomic_uint32_t squareWaveEdgeMs{0};
+    std::atomic_bool squareWaveEdgePending{false};
+    uint32_t lastSquareWaveEdgeMs;
+    bool squareWaveSeen;
 
     DS3231 ds3231{Wire};
     VideoSetting videoSetting{videoChannel};
     MixingStreamer streamer;
-    RecordingController recordingController{ds3231, streamer};
+    StorageManager storageManager{SDFs};
+    RecordingController recordingController{ds3231, streamer, storageManager, globalIdlePowerManager};
+
+    OsdLayer osd{videoChannel};
+    const auto osdDateField  = osd.addField(osdMargin, osdMargin, osdTextColor);
+    const auto osdTimeField  = osd.addField(osdMargin + osdCharWidth * 11, osdMargin, osdTextColor);
+    const auto osdRecField   = osd.addField(osdMargin, osdMargin + osdCharHeight, osdRecordingColor);
+    const auto osdSpaceField = osd.addField(osdMargin + osdCharWidth * 4, osdMargin + osdCharHeight, osdTextColor);
 
     HttpServer webServer{80};
     HttpServer liveStreamingServer{8080};
     BleServer bleServer{deviceName, serviceUuid, rxUuid, txUuid};
 
+    void onSquareWaveEdge(uint32_t id, uint32_t event) {
+        BaseType_t woken{};
+
+        squareWaveEdgeMs.store(millis(), std::memory_order_relaxed);
+        squareWaveEdgePending.store(true, std::memory_order_release);
+        vTaskNotifyGiveFromISR(globalMainTask, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+
+    // Aligns the clock to the last RTC second boundary. Returns whether the square wave is still arriving, in which
+    // case the loop runs once per second on its edges.
+    bool updateSquareWave() {
+        if (squareWaveEdgePending.exchange(false, std::memory_order_acq_rel)) {
+            lastSquareWaveEdgeMs = squareWaveEdgeMs.load(std::memory_order_relaxed);
+            squareWaveSeen       = true;
+            globalSystemClock.alignToSecond(lastSquareWaveEdgeMs);
+        }
+
+        return squareWaveSeen && millis() - lastSquareWaveEdgeMs < squareWaveTimeoutMs;
+    }
+
     void initMultimedia() {
         Camera.configVideoChannel(videoChannel, videoSetting);
         Camera.videoInit(0);
 
         streamer.init(Camera.getStream(videoChannel), videoStreamingMMFModule, videoSetting);
+        streamer.onBitrateChange([](uint32_t bitrate) { Camera.setBitrate(videoChannel, bitrate); });
+        streamer.onKeyframeRequest([] {
+            mm_module_ctrl(Camera.getStream(videoChannel)._p_mmf_context, CMD_VIDEO_FORCE_IFRAME, 1);
+        });
 
         // Configures the video overlay system.
         OSD.configVideo(videoChannel, videoSetting);
-        OSD.configTextSize(videoChannel, 30, 48);
+        OSD.configTextSize(videoChannel, osdCharWidth, osdCharHeight);
         OSD.begin();
     }
 
     void loadConfig() {
         SDFs.begin();
+        storageManager.begin();
         FlashMemory.begin(FLASH_MEMORY_APP_BASE, flashMemoryMappedSize);
+        globalConfigStore.begin();
+        globalConfigStore.dump();
 
-        globalAppMutex = xSemaphoreCreateMutex();
         globalAppConfig.update(AppConfig::fromFlash());
-        globalAppConfig.current()->first.dump();
+        globalAppConfig.snapshot()->dump();
+        recordingController.restore(ScheduleProgress::fromFlash());
     }
 
+    // Keeps the pinned config until a newer generation is published, so that the rest of the tick reads one version.
+    // A new generation is only saved and announced for the sections whose records actually differ.
     void updateConfigCache() {
-        auto cache               = globalAppConfig.current();
-        auto&& [config, updated] = *cache;
-
-        if (updated) {
-            config.saveToFlash();
-            config.dump();
+        if (appConfigCache && appConfigCache.generation() == globalAppConfig.generation()) {
+            return;
         }
 
-        appConfigCache = std::move(cache);
+        auto next          = globalAppConfig.snapshot();
+        const auto changes = appConfigCache ? next->diff(*appConfigCache) : AppConfig::Changes::all();
+
+        appConfigCache = std::move(next);
+
+        if (!changes.empty()) {
+            appConfigCache->saveToFlash();
+            appConfigCache->dump();
+            globalConfigNotifier.publish(*appConfigCache, changes);
+        }
     }
 
     void updateDateTime() {
         if (const auto timestamp = globalPendingTimestampSince2020.exchange(noPendingValue, std::memory_order_acq_rel);
             timestamp != noPendingValue) {
-            ds3231.setDateTime(TimeUtil::toDateTimeFromSince2020(timestamp));
+            globalSystemClock.set(TimeUtil::toUnixTimestampFromSince2020(timestamp));
             Serial.print("System time updated: ");
-            Serial.println(TimeUtil::toIso8601(ds3231.getDateTime()));
+            Serial.println(TimeUtil::toIso8601(globalSystemClock.dateTime()));
         }
     }
 
-    void updateWiFiHotspot() {
-        auto&& [config, updated] = *appConfigCache;
-
-        if (updated) {
-            if (config.hotspot.enabled) {
-                WiFiHotspot.start(config.hotspot.ssid, config.hotspot.password, 1);
-                webServer.start();
-                liveStreamingServer.start();
-                Serial.println("WiFi Hotspot started.");
-            } else {
-                webServer.stop();
-                liveStreamingServer.stop();
-                WiFiHotspot.stop();
-                Serial.println("WiFi Hotspot stopped.");
-            }
+    void updateWiFiHotspot(const AppConfig& config) {
+        if (config.hotspot.enabled) {
+            WiFiHotspot.start(config.hotspot.ssid, config.hotspot.password, 1);
+            webServer.start();
+            liveStreamingServer.start();
+            Serial.println("WiFi Hotspot started.");
+        } else {
+            webServer.stop();
+            liveStreamingServer.stop();
+            WiFiHotspot.stop();
+            Serial.println("WiFi Hotspot stopped.");
         }
     }
 
-    void driveRecording() {
-        auto&& [config, updated] = *appConfigCache;
+    TickType_t toTicks(uint32_t milliseconds) {
+        if (milliseconds == std::numeric_limits<uint32_t>::max()) {
+            return portMAX_DELAY;
+        }
+
+        // Avoids the 32-bit overflow of `pdMS_TO_TICKS` for waits spanning days.
+        return static_cast<TickType_t>(std::min<uint64_t>(
+            static_cast<uint64_t>(milliseconds) * configTICK_RATE_HZ / 1000, portMAX_DELAY - 1));
+    }
 
-        if (updated) {
-            recordingController.update(config.recording);
+    void updateOverlay(const DateTime& dateTime) {
+        static uint32_t lastFreeSpaceTime;
+        static bool freeSpaceShown;
+        char buffer[16];
+
+        // A field the layer had no block for is left out of the overlay.
+        const auto setText = [](std::optional<size_t> field, const char* text) {
+            if (field) {
+                osd.setText(*field, text);
+            }
+        };
+
+        std::snprintf(buffer, sizeof(buffer), "%04u-%02u-%02u", dateTime.year, dateTime.month, dateTime.day);
+        setText(osdDateField, buffer);
+        std::snprintf(buffer, sizeof(buffer), "%02u:%02u:%02u", dateTime.hour, dateTime.minute, dateTime.second);
+        setText(osdTimeField, buffer);
+        setText(osdRecField, streamer.recording() ? "REC" : "");
+
+        // Querying the free space walks the FAT, so it is refreshed far less often than the clock.
+        if (osdSpaceField && (!freeSpaceShown || millis() - lastFreeSpaceTime >= freeSpaceIntervalMs)) {
+            const auto freeMb = static_cast<uint64_t>(SDFs.get_free_space()) / (1024 * 1024);
+
+            std::snprintf(buffer, sizeof(buffer), "SD %lu.%luG", static_cast<unsigned long>(freeMb / 1024),
+                static_cast<unsigned long>(freeMb % 1024 * 10 / 1024));
+            osd.setText(*osdSpaceField, buffer);
+            lastFreeSpaceTime = millis();
+            freeSpaceShown    = true;
         }
 
-        recordingController.tick();
+        osd.render();
+    }
+
+    void subscribeConfig() {
+        globalConfigNotifier.subscribe({ConfigSection::schedule, ConfigSection::storage, ConfigSection::rotation},
+            [](const AppConfig& config, const AppConfig::Changes& changes) {
+                recordingController.update(config.recording, changes);
+            });
+        globalConfigNotifier.subscribe({ConfigSection::clock}, [](const AppConfig& config, const AppConfig::Changes&) {
+            globalSystemClock.setResyncInterval(config.clock.resyncSec);
+        });
+        // globalConfigNotifier.subscribe({ConfigSection::hotspot},
+        //     [](const AppConfig& config, const AppConfig::Changes&) { updateWiFiHotspot(config); });
+    }
+
+    uint32_t driveRecording() {
+        return recordingController.tick();
+    }
+
+    // The alarm fires ahead of the window by the slowest alarm boot seen so far, so a faster boot waits here for the
+    // window to open and its first tick starts the recording.
+    void waitForWindow() {
+        if (const auto waitMs = recordingController.msToNextStart(); waitMs && *waitMs <= windowWaitLimitMs) {
+            vTaskDelay(toTicks(*waitMs));
+        }
     }
 } // namespace
 
 void setup() {
+    globalMainTask = xTaskGetCurrentTaskHandle();
+
+    globalBootProfiler.enter("rtc");
+    ds3231.begin();
+    globalSystemClock.begin(ds3231);
+
+    // An alarm wake means a recording window is about to start, so the camera and the recorder come up first and
+    // nothing waits for a serial console.
+    const auto alarmWake = ds3231.alarm1Triggered();
+
+    globalBootProfiler.setAlarmWake(alarmWake);
+    globalBootProfiler.enter("serial");
     Serial.begin(115200);
 
-    while (!Serial) {
-        // Waits for serial port to connect. Needed for native USB port only。
-    }
+    if (!alarmWake) {
+        while (!Serial) {
+            // Waits for serial port to connect. Needed for native USB port only。
+        }
 
-    Serial.print("System free heap size: ");
-    Serial.println(xPortGetFreeHeapSize());
+        Serial.print("System free heap size: ");
+        Serial.println(xPortGetFreeHeapSize());
+    }
 
-    ds3231.begin();
+    globalBootProfiler.enter("config");
     loadConfig();
+    subscribeConfig();
+
+    globalBootProfiler.enter("multimedia");
     initMultimedia();
 
-    if (ds3231.alarm1Triggered()) {
+    // Starts feeding multimedia data.
+    globalBootProfiler.enter("camera");
+    Camera.channelBegin(videoChannel);
+
+    if (alarmWake) {
         ds3231.clearAlarm1Flag();
     }
 
+    ds3231.enableSquareWave(true);
+    ds3231.attachSquareWave(rtcInterruptPin, onSquareWaveEdge);
+
+    if (alarmWake) {
+        globalBootProfiler.enter("schedule");
+        updateConfigCache();
+
+        globalBootProfiler.enter("windowWait");
+        waitForWindow();
+
+        globalBootProfiler.enter("firstTick");
+        driveRecording();
+    }
+
+    globalBootProfiler.enter("services");
     webServer.setFallbackService(&fallbackService);
+    webServer.addService("POST /api/v1/getBootProfile", &bootProfileHttpService);
     liveStreamingServer.addService("GET /live", &videoStreamingService);
 
     bleServer.addService(RequestType::getSystemInfo, &systemInfoService);
     bleServer.addService(RequestType::getRecordingSchedule, &currentScheduleService);
     bleServer.addService(RequestType::setSystemTime, &updateTimeService);
     bleServer.addService(RequestType::setRecordingSchedule, &updateScheduleService);
+    bleServer.addService(RequestType::getBootProfile, &bootProfileService);
     bleServer.start();
 
-    // Starts feeding multimedia data.
-    Camera.channelBegin(videoChannel);
+    globalIdlePowerManager.setHandler(PowerTier::reducedFrameRate,
+        [](bool enter) { Camera.setFPS(videoChannel, enter ? idleFrameRate : videoFrameRate); });
+    globalIdlePowerManager.setHandler(PowerTier::encoderOff, [](bool enter) {
+        if (enter) {
+            Camera.channelEnd(videoChannel);
+        } else {
+            Camera.channelBegin(videoChannel);
+        }
+    });
+    globalIdlePowerManager.setHandler(PowerTier::radiosOff, [](bool enter) {
+        if (enter) {
+            bleServer.stop();
+        } else {
+            bleServer.start();
+        }
+    });
+
+    globalBootProfiler.finish();
+    globalBootProfiler.dump();
+    globalIdlePowerManager.dump();
 }
 
 void loop() {
-    static int32_t counter;
+    static String lastDateTimeText;
 
-    const auto dateTime     = ds3231.getDateTime();
-    const auto dateTimeText = TimeUtil::toIso8601(dateTime);
+    const auto squareWave = updateSquareWave();
 
-    globalNowSince2020.store(TimeUtil::toTimestampSince2020(dateTime), std::memory_order::release);
+    globalSystemClock.update();
 
-    OSD.createBitmap(videoChannel);
-    OSD.drawText(videoChannel, 36, 36, dateTimeText.c_str(), 0xFFFFFFFF);
-    OSD.update(videoChannel);
+    const auto dateTime     = globalSystemClock.dateTime();
+    const auto dateTimeText = TimeUtil::toIso8601(dateTime);
 
     updateDateTime();
     updateConfigCache();
-    // updateWiFiHotspot();
-    driveRecording();
+    const auto waitMs = driveRecording();
+
+    updateOverlay(dateTime);
 
-    if (appConfigCache->second) {
-        globalAppConfig.confirm();
+    // Sector erases stall flash access, so the config log is only tidied up while nothing is being recorded.
+    if (!streamer.recording()) {
+        globalConfigStore.maintain();
     }
 
-    if (++counter % 2 == 0) {
+    if (dateTimeText != lastDateTimeText) {
         Serial.println(dateTimeText);
+        lastDateTimeText = dateTimeText;
     }
 
-    vTaskDelay(500 / portTICK_PERIOD_MS);
+    // Blocks until the next RTC second boundary, or the next schedule transition when the square wave is missing, or
+    // until a service signals a time or config change.
+    ulTaskNotifyTake(pdTRUE, toTicks(squareWave ? squareWaveTimeoutMs : waitMs));
 }
@@ -1,11 +1,16 @@
 #include "AppConfig.hpp"
 
+#include "ConfigStore.hpp"
+#include "ProtocolSchema.hpp"
 #include "Resources.hpp"
-#include "TlvReader.hpp"
+#include "TlvConstants.hpp"
+#include "TlvParser.hpp"
 #include "TlvWriter.hpp"
 
 #include <algorithm>
+#include <array>
 #include <utility>
+#include <vector>
 
 #include <FlashMemory.h>
 #include <LOGUARTClass.h>
@@ -16,38 +21,156 @@ namespace {
     constexpr char defaultBaseName[]             = "recording";
     constexpr uint32_t defaultSingleFileDuration = 60 * 30;
     constexpr uint32_t maxSingleFileDuration     = 2048;
+    constexpr auto defaultDirectoryLayout        = DirectoryLayout::daily;
+    constexpr uint32_t defaultMinFreeSpaceMb     = 512;
+    constexpr uint32_t defaultClockResyncSec     = 10 * 60;
+    constexpr uint32_t minClockResyncSec         = 10;
+    constexpr int64_t secondsPerDay              = 24 * 60 * 60;
+    constexpr int64_t secondsPerHour             = 60 * 60;
+
+    constexpr int64_t toPeriod(const AppConfig::RecurringRule& rule) noexcept {
+        return rule.kind == RecurrenceKind::everyNHours ? rule.intervalHours * secondsPerHour : secondsPerDay;
+    }
+
+    // Values outside their range fall back to a safe default instead of failing the whole config.
+    void sanitize(AppConfig& config) {
+        if (config.recording.singleFileDuration > maxSingleFileDuration) {
+            config.recording.singleFileDuration = defaultSingleFileDuration;
+            Serial.print("Found invalid `SingleFileDuration`, using the recommended value ");
+            Serial.print(defaultSingleFileDuration);
+            Serial.println(".");
+        }
+
+        if (config.recording.directoryLayout > DirectoryLayout::hourly) {
+            Serial.println("Found invalid `DirectoryLayout`, using the default layout.");
+            config.recording.directoryLayout = defaultDirectoryLayout;
+        }
+
+        if (config.clock.resyncSec < minClockResyncSec) {
+            Serial.println("Found invalid `ClockResyncSec`, using the default interval.");
+            config.clock.resyncSec = defaultClockResyncSec;
+        }
+
+        for (auto&& rule : config.recording.rules) {
+            if (rule.kind > RecurrenceKind::everyNHours) {
+                Serial.println("Found invalid `RecurrenceKind`, the rule is disabled.");
+                rule = {};
+            }
+        }
+
+        auto&& schedule = config.recording.schedule;
+        auto&& rules    = config.recording.rules;
+
+        if (schedule.size() + rules.size() > AppConfig::maxScheduleEntries) {
+            Serial.print("Found ");
+            Serial.print(schedule.size() + rules.size());
+            Serial.print(" schedule entries, keeping the first ");
+            Serial.print(AppConfig::maxScheduleEntries);
+            Serial.println(", plans before rules.");
+            schedule.resize(std::min(schedule.size(), AppConfig::maxScheduleEntries));
+            rules.resize(AppConfig::maxScheduleEntries - schedule.size());
+        }
+    }
+
+    std::vector<uint8_t> encode(const AppConfig& config) {
+        TlvWriter sizer;
+
+        config.writeTlv(sizer);
+
+        std::vector<uint8_t> buffer(sizer.size());
+        TlvWriter writer{buffer};
+
+        config.writeTlv(writer);
+
+        return buffer;
+    }
+
+    // The bytes of each section's records within `message`. The schema writes the types in ascending order, so the
+    // records of a section are contiguous; sections without records stay empty.
+    std::array<std::span<const uint8_t>, Protocol::appConfigSectionCount> indexSections(
+        std::span<const uint8_t> message) {
+        std::array<std::span<const uint8_t>, Protocol::appConfigSectionCount> sections{};
+        auto recordBegin = message.begin() + TlvConstants::magic.size();
+        TlvParser parser;
+
+        // Values are handed out in place, so each record ends where its value does. An empty value only has the
+        // short header.
+        parser.feed(message, [&](uint8_t type, std::span<const uint8_t> value) {
+            const auto recordEnd = value.empty() ? recordBegin + TlvConstants::typeLengthSize
+                                                 : message.begin() + (value.data() - message.data()) + value.size();
+
+            if (const auto section = Protocol::appConfigSectionOf(type)) {
+                auto&& bytes = sections[static_cast<size_t>(*section)];
+
+                bytes = {bytes.empty() ? recordBegin : bytes.begin(), recordEnd};
+            }
+
+            recordBegin = recordEnd;
+        });
+
+        return sections;
+    }
+
+    // 1970-01-01 was a Thursday.
+    constexpr uint8_t toWeekday(int64_t timestamp) noexcept {
+        const auto days = timestamp >= 0 ? timestamp / secondsPerDay : (timestamp - secondsPerDay + 1) / secondsPerDay;
+
+        return static_cast<uint8_t>(((days + 4) % 7 + 7) % 7);
+    }
 } // namespace
 
-void AppConfig::saveToFlash() {
-    TlvWriter writer;
+// Returns the start of the first occurrence that ends after `timestamp`, or nothing if the rule never fires.
+std::optional<int64_t> AppConfig::RecurringRule::firstStartEndingAfter(int64_t timestamp) const {
+    const auto period = toPeriod(*this);
+
+    if (period <= 0 || duration == 0 || (kind == RecurrenceKind::weekdays && (weekdayMask & 0x7F) == 0)) {
+        return std::nullopt;
+    }
+
+    auto start = anchorTimestamp;
 
-    writeTlv(writer);
-    FlashMemory.read();
-    std::ranges::copy(writer.data(), FlashMemory.buf);
-    FlashMemory.write();
+    if (const auto elapsed = timestamp - duration - anchorTimestamp; elapsed >= 0) {
+        start += (elapsed / period + 1) * period;
+    }
+
+    while (kind == RecurrenceKind::weekdays && (weekdayMask & (1U << toWeekday(start))) == 0) {
+        start += secondsPerDay;
+    }
 
-    Serial.println("AppConfig saved to flash.");
+    return start;
 }
 
-void AppConfig::writeTlv(TlvWriter& writer) const {
-    writer.write(1, static_cast<uint8_t>(hotspot.enabled ? 1 : 0));
-    writer.write(2, hotspot.ssid, 12);
-    writer.write(3, hotspot.password, 8);
+// Compares the two versions section by section, so that a field counts as changed exactly when its stored bytes would.
+AppConfig::Changes AppConfig::diff(const AppConfig& previous) const {
+    const auto message          = encode(*this);
+    const auto previousMessage  = encode(previous);
+    const auto sections         = indexSections(message);
+    const auto previousSections = indexSections(previousMessage);
 
-    writer.write(4, recording.baseName, 12);
-    writer.write(5, recording.singleFileDuration);
+    Changes changes;
 
-    const auto scheduleCount = std::min(recording.schedule.size(), 8U);
+    for (size_t i = 0; i < sections.size(); i++) {
+        if (!std::ranges::equal(sections[i], previousSections[i])) {
+            changes.add(static_cast<ConfigSection>(i));
+        }
+    }
 
-    for (size_t i = 0; i < scheduleCount; i++) {
-        auto&& item = recording.schedule[i];
+    return changes;
+}
 
-        writer.write(static_cast<uint8_t>(100 + i * 2), static_cast<uint64_t>(item.startTimestamp));
-        writer.write(static_cast<uint8_t>(101 + i * 2), item.duration);
+void AppConfig::saveToFlash() const {
+    if (globalConfigStore.commit(encode(*this))) {
+        Serial.println("AppConfig saved to flash.");
+    } else {
+        Serial.println("AppConfig could not be saved to flash.");
     }
 }
 
-void AppConfig::dump() {
+void AppConfig::writeTlv(TlvWriter& writer) const {
+    Protocol::AppConfigSchema::encode(*this, writer);
+}
+
+void AppConfig::dump() const {
     Serial.println("AppConfig Dump:");
     Serial.print("  Hotspot Enabled: ");
     Serial.println(hotspot.enabled ? "Yes" : "No");
@@ -59,6 +182,18 @@ void AppConfig::dump() {
     Serial.println(recording.baseName);
     Serial.print("  Recording Single File Duration: ");
     Serial.println(recording.singleFileDuration);
+    Serial.print("  Recording Directory Layout: ");
+    Serial.println(static_cast<uint8_t>(recording.directoryLayout));
+    Serial.print("  Recording Min Free Space (MB): ");
+    Serial.println(recording.minFreeSpaceMb);
+    Serial.print("  Recording Max Segment Size (MB): ");
+    Serial.println(recording.rotation.maxSegmentSizeMb);
+    Serial.print("  Recording Rotation Alignment (sec): ");
+    Serial.println(recording.rotation.alignmentSec);
+    Serial.print("  Recording Keyframe Aligned: ");
+    Serial.println(recording.rotation.keyframeAligned ? "Yes" : "No");
+    Serial.print("  Clock Resync Interval (sec): ");
+    Serial.println(clock.resyncSec);
     Serial.println("  Recording Schedule:");
 
     for (size_t i = 0; i < recording.schedule.size(); i++) {
@@ -70,6 +205,24 @@ void AppConfig::dump() {
         Serial.print(", Duration: ");
         Serial.println(item.duration);
     }
+
+    Serial.println("  Recording Rules:");
+
+    for (size_t i = 0; i < recording.rules.size(); i++) {
+        auto&& item = recording.rules[i];
+        Serial.print("    [");
+        Serial.print(i);
+        Serial.print("] Anchor Timestamp: ");
+        Serial.print(item.anchorTimestamp);
+        Serial.print(", Duration: ");
+        Serial.print(item.duration);
+        Serial.print(", Kind: ");
+        Serial.print(static_cast<uint8_t>(item.kind));
+        Serial.print(", Weekday Mask: ");
+        Serial.print(item.weekdayMask);
+        Serial.print(", Interval (hours): ");
+        Serial.println(item.intervalHours);
+    }
 }
 
 AppConfig AppConfig::createDefault() {
@@ -83,61 +236,43 @@ AppConfig AppConfig::createDefault() {
             {
                 .baseName           = defaultBaseName,
                 .singleFileDuration = defaultSingleFileDuration,
+                .directoryLayout    = defaultDirectoryLayout,
+                .minFreeSpaceMb     = defaultMinFreeSpaceMb,
+            },
+        .clock =
+            {
+                .resyncSec = defaultClockResyncSec,
             },
     };
 }
 
 AppConfig AppConfig::fromFlash() {
-    FlashMemory.read();
-    Serial.println("AppConfig loaded from flash.");
+    if (!globalConfigStore.loaded()) {
+        // Configs saved before the config log existed are a single TLV message in the first sector. The first save
+        // moves them over.
+        FlashMemory.read();
+        Serial.println("AppConfig loaded from the legacy flash sector.");
 
-    return fromBuffer({FlashMemory.buf, FlashMemory.buf_size});
-}
+        return fromBuffer({FlashMemory.buf, FlashMemory.buf_size});
+    }
 
-AppConfig AppConfig::fromBuffer(std::span<const uint8_t> buffer) {
-    TlvReader reader{buffer};
     auto config = createDefault();
 
-    reader.registerHandler(1,
-        TlvReader::DataHandler<uint8_t>{[&](uint8_t type, uint8_t value) { config.hotspot.enabled = (value != 0); }});
-
-    reader.registerHandler(
-        2, TlvReader::DataHandler<String>{[&](uint8_t type, String value) { config.hotspot.ssid = std::move(value); }});
+    globalConfigStore.forEach([&](uint8_t type, std::span<const uint8_t> value) {
+        Protocol::AppConfigSchema::decodeRecord(config, type, value);
+    });
 
-    reader.registerHandler(3, TlvReader::DataHandler<String>{
-                                  [&](uint8_t type, String value) { config.hotspot.password = std::move(value); }});
-
-    reader.registerHandler(4, TlvReader::DataHandler<String>{
-                                  [&](uint8_t type, String value) { config.recording.baseName = std::move(value); }});
+    sanitize(config);
+    Serial.println("AppConfig loaded from flash.");
 
-    reader.registerHandler(5, TlvReader::DataHandler<uint32_t>{[&](uint8_t type, uint32_t value) {
-        if (value > maxSingleFileDuration) {
-            value = defaultSingleFileDuration;
-            Serial.println("Found invalid `SingleFileDuration`, using the recommended value ");
-            Serial.print(defaultSingleFileDuration);
-            Serial.println(".");
-        }
+    return config;
+}
 
-        config.recording.singleFileDuration = value;
-    }});
-
-    for (size_t i = 0; i < 8; i++) {
-        reader.registerHandler(
-            static_cast<uint8_t>(100 + i * 2), TlvReader::DataHandler<uint64_t>{[&, i](uint8_t type, uint64_t value) {
-                config.recording.schedule.resize(i + 1);
-                config.recording.schedule[i].startTimestamp = static_cast<int64_t>(value);
-                Serial.println(static_cast<int64_t>(value));
-            }});
-
-        reader.registerHandler(
-            static_cast<uint8_t>(101 + i * 2), TlvReader::DataHandler<uint32_t>{[&, i](uint8_t type, uint32_t value) {
-                config.recording.schedule.resize(i + 1);
-                config.recording.schedule[i].duration = value;
-                Serial.println(value);
-            }});
-    }
+AppConfig AppConfig::fromBuffer(std::span<const uint8_t> buffer) {
+    auto config = createDefault();
 
-    if (reader.readAll()) {
+    if (Protocol::AppConfigSchema::decode(buffer, config)) {
+        sanitize(config);
         Serial.println("AppConfig parsed from buffer.");
     } else {
         Serial.println("AppConfig parsing from buffer failed, using defaults where necessary.");
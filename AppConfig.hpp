@@ -1,8 +1,12 @@
 #pragma once
 
+#include "CommonTypes.hpp"
+#include "ProtocolSchema.hpp"
 #include "TrackedValue.hpp"
 
+#include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <span>
 #include <vector>
 
@@ -10,6 +14,8 @@
 
 class TlvWriter;
 
+using ConfigSection = Protocol::AppConfigSection;
+
 struct AppConfig {
     struct HotspotConfig {
         bool enabled{};
@@ -22,18 +28,73 @@ struct AppConfig {
         uint32_t duration{};
     };
 
+    // Repeats a window of `duration` seconds starting at `anchorTimestamp`, every day, on the days of `weekdayMask`
+    // (bit 0 is Sunday, in UTC) or every `intervalHours` hours.
+    struct RecurringRule {
+        int64_t anchorTimestamp{};
+        uint32_t duration{};
+        RecurrenceKind kind{};
+        uint8_t weekdayMask{};
+        uint16_t intervalHours{};
+
+        std::optional<int64_t> firstStartEndingAfter(int64_t timestamp) const;
+    };
+
+    struct RotationConfig {
+        uint32_t maxSegmentSizeMb{};
+        uint32_t alignmentSec{};
+        bool keyframeAligned{};
+    };
+
     struct RecordingConfig {
         String baseName;
         uint32_t singleFileDuration{};
+        DirectoryLayout directoryLayout{};
+        uint32_t minFreeSpaceMb{};
+        RotationConfig rotation;
         std::vector<RecordingPlan> schedule;
+        std::vector<RecurringRule> rules;
+    };
+
+    struct ClockConfig {
+        uint32_t resyncSec{};
     };
 
+    // Sections whose encoded records differ between two versions.
+    struct Changes {
+        static_assert(Protocol::appConfigSectionCount < 32);
+
+        uint32_t sections{};
+
+        static constexpr Changes all() noexcept {
+            return {(1U << Protocol::appConfigSectionCount) - 1};
+        }
+
+        constexpr void add(ConfigSection section) noexcept {
+            sections |= 1U << static_cast<uint32_t>(section);
+        }
+
+        constexpr bool contains(ConfigSection section) const noexcept {
+            return (sections & (1U << static_cast<uint32_t>(section))) != 0;
+        }
+
+        constexpr bool empty() const noexcept {
+            return sections == 0;
+        }
+    };
+
+    // Plans and rules together. The schedule response carries the whole configuration in one BTP transfer, and with
+    // the longest strings only this many rules, the largest entries at 22 bytes each, fit its 230 bytes.
+    static constexpr size_t maxScheduleEntries = 6;
+
     HotspotConfig hotspot;
     RecordingConfig recording;
+    ClockConfig clock;
 
-    void saveToFlash();
+    Changes diff(const AppConfig& previous) const;
+    void saveToFlash() const;
     void writeTlv(TlvWriter& writer) const;
-    void dump();
+    void dump() const;
 
     static AppConfig createDefault();
     static AppConfig fromFlash();
@@ -3,6 +3,7 @@
 #include "BleService.hpp"
 #include "BtpTransport.hpp"
 #include "BtpTransportScheduler.hpp"
+#include "IdlePowerManager.hpp"
 
 #include <unordered_map>
 
@@ -18,7 +19,14 @@ public:
         services_.emplace(type, service);
     }
 
+    // The BLE stack is only set up once; later calls resume advertising after `stop`.
     void start() {
+        if (started_) {
+            transport_.resume();
+            Serial.println("BLE advertising resumed.");
+            return;
+        }
+
         transport_.onError([](const char* msg) {
             Serial.print("BTP Error: ");
             Serial.println(msg);
@@ -32,6 +40,8 @@ public:
 
             const auto type = data[0];
 
+            globalIdlePowerManager.noteActivity();
+
             Serial.print("BTPScheduler: type `");
             Serial.print(type);
             Serial.println("` received, now start parsing.");
@@ -41,16 +51,22 @@ public:
             }
         });
 
-        scheduler_.start(deviceName_.c_str());
+        started_ = scheduler_.start(deviceName_.c_str());
     }
 
-    void stop() {}
+    void stop() {
+        if (started_) {
+            transport_.suspend();
+            Serial.println("BLE advertising stopped.");
+        }
+    }
 
 private:
     String deviceName_;
     Btp::BtpTransport transport_;
     Btp::BtpTransportScheduler scheduler_;
     std::unordered_map<uint8_t, BleService*> services_;
+    bool started_{};
 };
 
 BleServer::BleServer(const String& deviceName, const String& serviceUuid, const String& rxUuid, const String& txUuid)
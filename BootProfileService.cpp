@@ -0,0 +1,106 @@
+#include "BinaryUtil.hpp"
+#include "BleService.hpp"
+#include "BootProfiler.hpp"
+#include "BtpConstants.hpp"
+#include "HttpMessageServer.hpp"
+#include "HttpService.hpp"
+#include "TlvConstants.hpp"
+#include "TlvWriter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include <Client.h>
+#include <WString.h>
+
+namespace {
+    constexpr size_t headerSize = 6;
+    constexpr size_t stageSize  = BootProfiler::maxNameLength + 1 + 8;
+    constexpr size_t recordSize = headerSize + BootProfiler::maxStageCount * stageSize;
+
+    static_assert(TlvConstants::magic.size() + TlvConstants::typeLengthSize + recordSize <= Btp::Constants::mtu);
+
+    // Each boot is one TLV entry of type `1 + i`, newest first: sequence u32, alarm wake u8, stage count u8, then per
+    // stage a zero-padded name and the start and end in microseconds as u32. BLE and HTTP share the layout.
+    void writeRecord(TlvWriter& writer, size_t index) {
+        std::array<uint8_t, recordSize> buffer;
+        auto&& record     = globalBootProfiler.history()[index];
+        const std::span output{buffer};
+
+        BinaryUtil::writeU32Be(output, record.sequence);
+        output[4] = record.alarmWake;
+        output[5] = record.stageCount;
+
+        for (size_t j = 0; j < record.stageCount; j++) {
+            auto&& stage      = record.stages[j];
+            const auto target = output.subspan(headerSize + j * stageSize, stageSize);
+
+            std::copy(stage.name.begin(), stage.name.end(), target.begin());
+            BinaryUtil::writeU32Be(target.subspan(stage.name.size()), stage.startUs);
+            BinaryUtil::writeU32Be(target.subspan(stage.name.size() + 4), stage.endUs);
+        }
+
+        writer.write(static_cast<uint8_t>(1 + index), output.first(headerSize + record.stageCount * stageSize));
+    }
+
+    // One record fills most of a transfer, so BLE clients page through the history: the request carries the index
+    // of a boot, 0 for the newest, and the answer holds that record alone. An index past the oldest boot answers an
+    // empty message, which ends the paging.
+    class BootProfileService : public BleService {
+    public:
+        void run(uint8_t type, std::span<const uint8_t> data, SendHandler sendHandler) override {
+            TlvWriter writer{response_};
+            const size_t index = data.empty() ? 0 : data[0];
+
+            if (index < globalBootProfiler.history().size()) {
+                writeRecord(writer, index);
+            }
+
+            sendHandler(writer.data());
+        }
+
+    private:
+        std::array<uint8_t, Btp::Constants::mtu> response_{};
+    };
+
+    // Answers the same `POST` the web client sends for every TLV request, with room for the whole history.
+    class BootProfileHttpService : public HttpService {
+    public:
+        void run(const String& methodPath, HttpMessage& message, Client& client) override {
+            TlvWriter writer{response_};
+
+            for (size_t i = 0; i < globalBootProfiler.history().size(); i++) {
+                writeRecord(writer, i);
+            }
+
+            const auto body = writer.data();
+            HttpMessageServer response{client};
+
+            response.setContentType("application/octet-stream");
+            response.setContentLength(body.size());
+            response.setHeader("Connection", "close");
+            response.writeHeader();
+            client.write(body.data(), body.size());
+        }
+
+    private:
+        std::array<uint8_t,
+            TlvConstants::magic.size() + BootProfiler::historySize * (TlvConstants::typeLengthSize + recordSize)>
+            response_{};
+    };
+} // namespace
+
+auto&& bootProfileService = []() -> BleService& {
+    static BootProfileService service;
+
+    return service;
+}();
+
+auto&& bootProfileHttpService = []() -> HttpService& {
+    static BootProfileHttpService service;
+
+    return service;
+}();
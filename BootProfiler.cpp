@@ -0,0 +1,114 @@
+#include "BootProfiler.hpp"
+
+#include "Resources.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include <Arduino.h>
+#include <FlashMemory.h>
+#include <LOGUARTClass.h>
+
+namespace {
+    constexpr uint32_t historyMagic   = 0x424F4F54; // "BOOT"
+    constexpr uint32_t historyVersion = 2;
+
+    // Records are kept newest first.
+    struct StoredHistory {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t count;
+        std::array<BootProfiler::Record, BootProfiler::historySize> records;
+    };
+
+    static_assert(std::is_trivially_copyable_v<StoredHistory>);
+    static_assert(sizeof(StoredHistory) <= flashMemoryMappedSize);
+} // namespace
+
+void BootProfiler::enter(const char* name) {
+    closeStage();
+
+    if (current_.stageCount == current_.stages.size()) {
+        return;
+    }
+
+    auto&& stage = current_.stages[current_.stageCount++];
+
+    std::strncpy(stage.name.data(), name, maxNameLength);
+    stage.startUs = micros();
+    open_         = true;
+}
+
+void BootProfiler::finish() {
+    closeStage();
+    persist();
+}
+
+bool BootProfiler::alarmWake() const noexcept {
+    return current_.alarmWake != 0;
+}
+
+void BootProfiler::setAlarmWake(bool value) noexcept {
+    current_.alarmWake = value ? 1 : 0;
+}
+
+std::span<const BootProfiler::Record> BootProfiler::history() const noexcept {
+    return {history_.data(), historyCount_};
+}
+
+void BootProfiler::dump() const {
+    Serial.print("Boot #");
+    Serial.print(current_.sequence);
+    Serial.print(alarmWake() ? " (alarm wake)" : " (cold boot)");
+    Serial.println(" stages:");
+
+    for (size_t i = 0; i < current_.stageCount; i++) {
+        auto&& item = current_.stages[i];
+
+        Serial.print("  ");
+        Serial.print(item.name.data());
+        Serial.print(": ");
+        Serial.print(item.endUs - item.startUs);
+        Serial.print(" us (at ");
+        Serial.print(item.startUs);
+        Serial.println(" us)");
+    }
+}
+
+void BootProfiler::closeStage() {
+    if (open_) {
+        current_.stages[current_.stageCount - 1].endUs = micros();
+        open_                                          = false;
+    }
+}
+
+// Reads the ring once at the end of `setup()`, so that services only ever read the copy in RAM and never race the
+// main loop for the shared flash buffer.
+void BootProfiler::persist() {
+    static StoredHistory stored;
+
+    FlashMemory.read(bootProfileFlashOffset);
+    std::memcpy(&stored, FlashMemory.buf, sizeof(stored));
+
+    if (stored.magic != historyMagic || stored.version != historyVersion || stored.count > historySize) {
+        stored = {
+            .magic   = historyMagic,
+            .version = historyVersion,
+        };
+    }
+
+    current_.sequence = stored.count != 0 ? stored.records[0].sequence + 1 : 1;
+
+    std::shift_right(stored.records.begin(), stored.records.end(), 1);
+    stored.records[0] = current_;
+    stored.count      = std::min<uint32_t>(stored.count + 1, historySize);
+
+    std::memcpy(FlashMemory.buf, &stored, sizeof(stored));
+    FlashMemory.write(bootProfileFlashOffset);
+
+    history_      = stored.records;
+    historyCount_ = stored.count;
+}
+
+BootProfiler globalBootProfiler;
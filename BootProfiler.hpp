@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Times the stages of `setup()` in microseconds and keeps the profiles of the last boots in a flash ring. Stages are
+// entered from the main task before any service can read them, and nothing changes once `finish` is called.
+class BootProfiler {
+public:
+    // Sized so that one record, names included, fits a BLE transfer.
+    static constexpr size_t maxStageCount = 10;
+    static constexpr size_t maxNameLength = 11;
+    static constexpr size_t historySize   = 8;
+
+    struct Stage {
+        std::array<char, maxNameLength + 1> name{};
+        uint32_t startUs{};
+        uint32_t endUs{};
+    };
+
+    struct Record {
+        uint32_t sequence{};
+        uint8_t alarmWake{};
+        uint8_t stageCount{};
+        std::array<Stage, maxStageCount> stages{};
+    };
+
+    void enter(const char* name);
+    void finish();
+    bool alarmWake() const noexcept;
+    void setAlarmWake(bool value) noexcept;
+    std::span<const Record> history() const noexcept;
+    void dump() const;
+
+private:
+    void closeStage();
+    void persist();
+
+    Record current_;
+    std::array<Record, historySize> history_{};
+    size_t historyCount_{};
+    bool open_{};
+};
+
+extern BootProfiler globalBootProfiler;
@@ -50,6 +50,21 @@ namespace Btp {
             return true;
         }
 
+        // Drops the connection and stops advertising, leaving the GATT database in place for `resume`.
+        void suspend() {
+            if (connId_ >= 0) {
+                BLE.configConnection()->disconnect(static_cast<uint8_t>(connId_));
+                connId_        = -1;
+                notifyEnabled_ = false;
+            }
+
+            BLE.configAdvert()->stopAdv();
+        }
+
+        void resume() {
+            BLE.configAdvert()->startAdv();
+        }
+
         bool send(const uint8_t* data, size_t size) {
             if (size > Constants::mtu) {
                 if (onError_) {
@@ -148,6 +163,14 @@ namespace Btp {
         return impl_->begin(deviceName);
     }
 
+    void BtpTransport::suspend() const {
+        impl_->suspend();
+    }
+
+    void BtpTransport::resume() const {
+        impl_->resume();
+    }
+
     bool BtpTransport::send(const uint8_t* data, size_t size) const {
         return impl_->send(data, size);
     }
@@ -17,6 +17,8 @@ namespace Btp {
         BtpTransport& operator=(BtpTransport&&) noexcept;
 
         bool begin(const char* deviceName) const;
+        void suspend() const;
+        void resume() const;
         bool send(const uint8_t* data, size_t size) const;
         bool send(std::span<const uint8_t> data) const;
 
@@ -1,8 +1,32 @@
 #pragma once
 
+#include <cstdint>
+
 enum class RequestType {
     getSystemInfo,
     setSystemTime,
     getRecordingSchedule,
     setRecordingSchedule,
+    getBootProfile,
+};
+
+enum class DirectoryLayout : uint8_t {
+    flat,
+    daily,
+    hourly,
+};
+
+enum class RecurrenceKind : uint8_t {
+    daily,
+    weekdays,
+    everyNHours,
+};
+
+// Ordered from the most to the least power drawn; each tier keeps everything the deeper ones have switched off.
+enum class PowerTier : uint8_t {
+    full,
+    reducedFrameRate,
+    encoderOff,
+    radiosOff,
+    deepSleep,
 };
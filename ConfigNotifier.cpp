@@ -0,0 +1,23 @@
+#include "ConfigNotifier.hpp"
+
+#include <utility>
+
+void ConfigNotifier::subscribe(std::initializer_list<ConfigSection> sections, Handler handler) {
+    AppConfig::Changes mask;
+
+    for (const auto section : sections) {
+        mask.add(section);
+    }
+
+    subscribers_.push_back({mask, std::move(handler)});
+}
+
+void ConfigNotifier::publish(const AppConfig& config, const AppConfig::Changes& changes) const {
+    for (auto&& subscriber : subscribers_) {
+        if ((subscriber.sections.sections & changes.sections) != 0) {
+            subscriber.handler(config, changes);
+        }
+    }
+}
+
+ConfigNotifier globalConfigNotifier;
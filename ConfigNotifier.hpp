@@ -0,0 +1,28 @@
+#pragma once
+
+#include "AppConfig.hpp"
+
+#include <functional>
+#include <initializer_list>
+#include <vector>
+
+// Hands config changes to the parts of the firmware that depend on them, so that a schedule update does not restart
+// the hotspot and a hotspot change does not rebuild the schedule. Handlers run on the main task, in subscription
+// order, once per change that touches any of their sections.
+class ConfigNotifier {
+public:
+    using Handler = std::function<void(const AppConfig& config, const AppConfig::Changes& changes)>;
+
+    void subscribe(std::initializer_list<ConfigSection> sections, Handler handler);
+    void publish(const AppConfig& config, const AppConfig::Changes& changes) const;
+
+private:
+    struct Subscriber {
+        AppConfig::Changes sections;
+        Handler handler;
+    };
+
+    std::vector<Subscriber> subscribers_;
+};
+
+extern ConfigNotifier globalConfigNotifier;
@@ -0,0 +1,366 @@
+#include "ConfigStore.hpp"
+
+#include "BinaryUtil.hpp"
+#include "HashUtil.hpp"
+#include "Resources.hpp"
+#include "TlvParser.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+#include <FlashMemory.h>
+#include <LOGUARTClass.h>
+
+namespace {
+    constexpr uint32_t sectorMagic      = 0x434C4F47; // "CLOG"
+    constexpr size_t sectorSize         = flashMemoryMappedSize;
+    constexpr size_t sectorHeaderSize   = 12;
+    constexpr size_t recordHeaderSize   = 4;
+    constexpr size_t recordCrcSize      = 4;
+    constexpr size_t wordSize           = 4;
+    constexpr uint8_t erasedByte        = 0xFF;
+    constexpr size_t compactionFillSize = sectorSize * 3 / 4;
+
+    static_assert(sizeof(unsigned int) == wordSize);
+
+    // Every record is word aligned: kind, type, u16 value length, the value padded with erased bytes, and the CRC of
+    // the header and value. A commit record closes the records before it and carries the digest of the values they
+    // produce.
+    enum class RecordKind : uint8_t {
+        value  = 1,
+        remove = 2,
+        commit = 3,
+    };
+
+    struct PendingRecord {
+        RecordKind kind;
+        uint8_t type;
+        std::span<const uint8_t> value;
+    };
+
+    constexpr size_t recordSize(size_t valueSize) noexcept {
+        return recordHeaderSize + (valueSize + wordSize - 1) / wordSize * wordSize + recordCrcSize;
+    }
+
+    void appendRecord(std::vector<uint8_t>& out, RecordKind kind, uint8_t type, std::span<const uint8_t> value) {
+        const auto start = out.size();
+
+        out.resize(start + recordSize(value.size()), erasedByte);
+
+        const auto record = std::span{out}.subspan(start);
+
+        record[0] = static_cast<uint8_t>(kind);
+        record[1] = type;
+        BinaryUtil::writeU16Be(record.subspan(2), static_cast<uint16_t>(value.size()));
+        std::copy(value.begin(), value.end(), record.begin() + recordHeaderSize);
+        BinaryUtil::writeU32Be(
+            record.last(recordCrcSize), HashUtil::crc32(record.first(recordHeaderSize + value.size())));
+    }
+
+    // CRC over every live value with its type and length, in type order. Record CRCs only vouch for single records; the
+    // digest also catches a replay that went wrong, such as an old record resurfacing from a half-erased sector.
+    std::array<uint8_t, 4> digest(const std::map<uint8_t, std::vector<uint8_t>>& values) noexcept {
+        uint32_t crc = 0;
+
+        for (auto&& [type, value] : values) {
+            std::array<uint8_t, 3> key{type};
+
+            BinaryUtil::writeU16Be(std::span{key}.subspan(1), static_cast<uint16_t>(value.size()));
+            crc = HashUtil::crc32(value, HashUtil::crc32(key, crc));
+        }
+
+        std::array<uint8_t, 4> bytes;
+
+        BinaryUtil::writeU32Be(bytes, crc);
+
+        return bytes;
+    }
+
+    std::array<uint8_t, sectorHeaderSize> makeSectorHeader(uint32_t sequence) noexcept {
+        std::array<uint8_t, sectorHeaderSize> header{};
+
+        BinaryUtil::writeU32Be(std::span{header}.subspan(0), sectorMagic);
+        BinaryUtil::writeU32Be(std::span{header}.subspan(4), sequence);
+        BinaryUtil::writeU32Be(std::span{header}.subspan(8), HashUtil::crc32(std::span{header}.first(8)));
+
+        return header;
+    }
+} // namespace
+
+ConfigStore::ConfigStore(size_t flashOffset, size_t sectorCount)
+    : flashOffset_{flashOffset}, sectorCount_{sectorCount} {}
+
+// Headers are checked word by word, then only the newest sector is read in full, unless its snapshot never got
+// committed and an older generation has to take over.
+void ConfigStore::begin() {
+    std::vector<std::pair<uint32_t, size_t>> candidates;
+
+    for (size_t sector = 0; sector < sectorCount_; sector++) {
+        std::array<uint8_t, sectorHeaderSize> header;
+
+        for (size_t i = 0; i < sectorHeaderSize; i += wordSize) {
+            const unsigned int word = FlashMemory.readWord(sectorOffset(sector) + i);
+
+            std::memcpy(header.data() + i, &word, wordSize);
+        }
+
+        if (const auto sequence = BinaryUtil::readU32Be(std::span{header}.subspan(4));
+            header == makeSectorHeader(sequence)) {
+            candidates.emplace_back(sequence, sector);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), std::greater{});
+
+    for (auto&& [sequence, sector] : candidates) {
+        Values values;
+        size_t appendOffset{};
+
+        if (scan(sector, values, appendOffset)) {
+            values_       = std::move(values);
+            active_       = sector;
+            sequence_     = sequence;
+            appendOffset_ = appendOffset;
+            valid_        = true;
+            break;
+        }
+
+        Serial.print("ConfigStore generation ");
+        Serial.print(sequence);
+        Serial.println(" was never committed, falling back to the previous one.");
+    }
+
+    if (valid_) {
+        FlashMemory.read(sectorOffset((active_ + 1) % sectorCount_));
+        spareErased_ = std::all_of(
+            FlashMemory.buf, FlashMemory.buf + sectorSize, [](uint8_t byte) { return byte == erasedByte; });
+    }
+}
+
+bool ConfigStore::loaded() const noexcept {
+    return valid_;
+}
+
+// Takes a whole TLV message and writes the records that differ from the stored ones, plus removals for the types the
+// message no longer has. Returns false if the message is malformed or cannot be stored.
+bool ConfigStore::commit(std::span<const uint8_t> message) {
+    Values next;
+    TlvParser parser;
+
+    const auto parsed = parser.feed(message, [&](uint8_t type, std::span<const uint8_t> value) {
+        if (!value.empty()) {
+            next[type].assign(value.begin(), value.end());
+        }
+    });
+
+    if (!parsed || !parser.valid()) {
+        return false;
+    }
+
+    std::vector<uint8_t> transaction;
+
+    for (auto&& [type, value] : next) {
+        if (const auto it = values_.find(type); it == values_.end() || it->second != value) {
+            appendRecord(transaction, RecordKind::value, type, value);
+        }
+    }
+
+    for (auto&& [type, value] : values_) {
+        if (!next.contains(type)) {
+            appendRecord(transaction, RecordKind::remove, type, {});
+        }
+    }
+
+    if (transaction.empty()) {
+        return true;
+    }
+
+    appendRecord(transaction, RecordKind::commit, 0, digest(next));
+
+    if (valid_ && appendOffset_ + transaction.size() <= sectorSize) {
+        program(sectorOffset(active_) + appendOffset_, transaction);
+        appendOffset_ += transaction.size();
+    } else if (!compact(next)) {
+        return false;
+    }
+
+    values_ = std::move(next);
+
+    return true;
+}
+
+// Does at most one slow step per call: erasing the spare sector, or compacting into it once the active sector is
+// mostly full. Meant to run from the main loop between ticks.
+void ConfigStore::maintain() {
+    if (!valid_) {
+        return;
+    }
+
+    if (!spareErased_) {
+        erase((active_ + 1) % sectorCount_);
+        spareErased_ = true;
+    } else if (appendOffset_ >= compactionFillSize) {
+        compact(values_);
+    }
+}
+
+void ConfigStore::dump() const {
+    if (!valid_) {
+        Serial.println("ConfigStore: no committed generation.");
+        return;
+    }
+
+    Serial.print("ConfigStore: generation ");
+    Serial.print(sequence_);
+    Serial.print(" in sector ");
+    Serial.print(active_);
+    Serial.print(", ");
+    Serial.print(values_.size());
+    Serial.print(" records, ");
+    Serial.print(appendOffset_);
+    Serial.print(" of ");
+    Serial.print(sectorSize);
+    Serial.println(" bytes used.");
+}
+
+size_t ConfigStore::sectorOffset(size_t sector) const noexcept {
+    return flashOffset_ + sector * sectorSize;
+}
+
+// Replays the committed transactions of one sector, up to the first record that fails its CRC or a commit whose digest
+// does not match, leaving `values` at the last generation that checks out. Anything after that, torn or corrupt,
+// cannot be programmed over, so the next commit is pushed to a fresh sector.
+bool ConfigStore::scan(size_t sector, Values& values, size_t& appendOffset) {
+    FlashMemory.read(sectorOffset(sector));
+
+    const std::span<const uint8_t> buffer{FlashMemory.buf, sectorSize};
+    std::vector<PendingRecord> pending;
+    size_t offset  = sectorHeaderSize;
+    bool committed = false;
+    bool clean     = false;
+
+    while (offset + recordSize(0) <= buffer.size()) {
+        const auto header = buffer.subspan(offset, recordHeaderSize);
+
+        if (std::all_of(header.begin(), header.end(), [](uint8_t byte) { return byte == erasedByte; })) {
+            clean = true;
+            break;
+        }
+
+        const auto length = BinaryUtil::readU16Be(header.subspan(2));
+        const auto size   = recordSize(length);
+
+        if (offset + size > buffer.size()) {
+            break;
+        }
+
+        const auto record = buffer.subspan(offset, size);
+
+        if (BinaryUtil::readU32Be(record.last(recordCrcSize))
+            != HashUtil::crc32(record.first(recordHeaderSize + length))) {
+            reportCorruption(sector, offset, "fails its CRC");
+            break;
+        }
+
+        const auto kind = static_cast<RecordKind>(header[0]);
+
+        if (kind == RecordKind::commit) {
+            auto next = values;
+
+            for (auto&& item : pending) {
+                if (item.kind == RecordKind::remove) {
+                    next.erase(item.type);
+                } else {
+                    next[item.type].assign(item.value.begin(), item.value.end());
+                }
+            }
+
+            if (!std::ranges::equal(record.subspan(recordHeaderSize, length), digest(next))) {
+                reportCorruption(sector, offset, "does not match its digest");
+                break;
+            }
+
+            values = std::move(next);
+            pending.clear();
+            committed = true;
+        } else if (kind == RecordKind::value || kind == RecordKind::remove) {
+            pending.push_back({kind, header[1], record.subspan(recordHeaderSize, length)});
+        } else {
+            reportCorruption(sector, offset, "has an unknown kind");
+            break;
+        }
+
+        offset += size;
+    }
+
+    appendOffset = clean && pending.empty() ? offset : sectorSize;
+
+    return committed;
+}
+
+void ConfigStore::reportCorruption(size_t sector, size_t offset, const char* problem) const {
+    Serial.print("ConfigStore record at ");
+    Serial.print(offset);
+    Serial.print(" in sector ");
+    Serial.print(sector);
+    Serial.print(" ");
+    Serial.print(problem);
+    Serial.println(", keeping the generation before it.");
+}
+
+// Writes all `values` as the snapshot of a new generation in the spare sector. Until its commit marker is programmed,
+// the previous generation stays the newest valid one.
+bool ConfigStore::compact(const Values& values) {
+    const auto target   = (active_ + 1) % sectorCount_;
+    const auto sequence = sequence_ + 1;
+    const auto header   = makeSectorHeader(sequence);
+
+    std::vector<uint8_t> image{header.begin(), header.end()};
+
+    for (auto&& [type, value] : values) {
+        appendRecord(image, RecordKind::value, type, value);
+    }
+
+    appendRecord(image, RecordKind::commit, 0, digest(values));
+
+    if (image.size() > sectorSize) {
+        Serial.print("ConfigStore snapshot needs ");
+        Serial.print(image.size());
+        Serial.println(" bytes and does not fit in a sector.");
+        return false;
+    }
+
+    if (valid_ && spareErased_) {
+        program(sectorOffset(target), image);
+    } else {
+        std::fill(FlashMemory.buf, FlashMemory.buf + sectorSize, erasedByte);
+        std::copy(image.begin(), image.end(), FlashMemory.buf);
+        FlashMemory.write(sectorOffset(target));
+    }
+
+    active_       = target;
+    sequence_     = sequence;
+    appendOffset_ = image.size();
+    valid_        = true;
+    spareErased_  = false;
+
+    return true;
+}
+
+void ConfigStore::program(size_t offset, std::span<const uint8_t> bytes) {
+    for (size_t i = 0; i < bytes.size(); i += wordSize) {
+        unsigned int word;
+
+        std::memcpy(&word, bytes.data() + i, wordSize);
+        FlashMemory.writeWord(offset + i, word);
+    }
+}
+
+void ConfigStore::erase(size_t sector) {
+    std::fill(FlashMemory.buf, FlashMemory.buf + sectorSize, erasedByte);
+    FlashMemory.write(sectorOffset(sector));
+}
+
+ConfigStore globalConfigStore{configStoreFlashOffset, configStoreSectorCount};
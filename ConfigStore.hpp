@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <span>
+#include <vector>
+
+// Log-structured key-value store over a ring of flash sectors, keyed by TLV type. `commit` appends only the records
+// whose value changed, closed by a commit marker, so that a config change programs a few words instead of erasing a
+// sector. When the active sector runs out of room, the live values are compacted into the next sector as a snapshot;
+// `maintain` does that ahead of time and erases the following sector, so that commits rarely wait for an erase.
+//
+// Loading scans the newest sector whose snapshot was committed. Records after the last commit marker are dropped, so
+// a write cut short by power loss leaves the previous generation in place. Every record has a CRC and every commit
+// marker the digest of the values it commits, so a corrupt record also rolls back to the generation before it, and
+// a corrupt snapshot to the previous sector of the ring, which is only erased once the ring wraps around.
+class ConfigStore {
+public:
+    ConfigStore(size_t flashOffset, size_t sectorCount);
+
+    void begin();
+    bool loaded() const noexcept;
+    bool commit(std::span<const uint8_t> message);
+    void maintain();
+    void dump() const;
+
+    // Calls `handler(type, value)` for the live records, in type order.
+    template <typename Handler>
+    void forEach(Handler&& handler) const {
+        for (auto&& [type, value] : values_) {
+            handler(type, std::span<const uint8_t>{value});
+        }
+    }
+
+private:
+    using Values = std::map<uint8_t, std::vector<uint8_t>>;
+
+    size_t sectorOffset(size_t sector) const noexcept;
+    bool scan(size_t sector, Values& values, size_t& appendOffset);
+    bool compact(const Values& values);
+    void program(size_t offset, std::span<const uint8_t> bytes);
+    void erase(size_t sector);
+    void reportCorruption(size_t sector, size_t offset, const char* problem) const;
+
+    size_t flashOffset_;
+    size_t sectorCount_;
+    Values values_;
+    size_t active_{};
+    uint32_t sequence_{};
+    size_t appendOffset_{};
+    bool valid_{};
+    bool spareErased_{};
+};
+
+extern ConfigStore globalConfigStore;
@@ -1,32 +1,39 @@
 #include "AppConfig.hpp"
 #include "BleService.hpp"
-#include "Resources.hpp"
+#include "BtpConstants.hpp"
 #include "TlvWriter.hpp"
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
 
-#if 1
-#include <FreeRTOS.h>
-#endif
-
-#include <semphr.h>
+#include <LOGUARTClass.h>
 
 namespace {
     class CurrentScheduleService : public BleService {
     public:
         void run(uint8_t type, std::span<const uint8_t> data, SendHandler sendHandler) override {
-            xSemaphoreTake(globalAppMutex, portMAX_DELAY);
-            const auto config = globalAppConfig.current()->first;
-            xSemaphoreGive(globalAppMutex);
+            const auto config = globalAppConfig.snapshot();
+
+            TlvWriter writer{response_};
+
+            config->writeTlv(writer);
+
+            // A BTP message never spans transfers, so a configuration that does not fit is refused instead of being
+            // sent cut off, which would read as a shorter schedule.
+            if (writer.overflowed()) {
+                Serial.print("Schedule response does not fit, ");
+                Serial.print(writer.size());
+                Serial.println(" bytes needed.");
+
+                return sendHandler(std::array<uint8_t, 4>{'F', 'A', 'I', 'L'});
+            }
 
-            writer_.clear();
-            config.writeTlv(writer_);
-            sendHandler(writer_.data());
+            sendHandler(writer.data());
         }
 
     private:
-        TlvWriter writer_;
+        std::array<uint8_t, Btp::Constants::mtu> response_{};
     };
 } // namespace
 
@@ -1,7 +1,9 @@
 #include "DS3231.hpp"
 
+#include <cstddef>
 #include <cstdint>
 
+#include <Arduino.h>
 #include <Wire.h>
 
 namespace {
@@ -13,64 +15,39 @@ namespace {
         bcd = ((val / 10) << 4) | (val % 10);
     }
 
-    void setAlarm(TwoWire& wire, const DateTime& dateTime, uint8_t alarmReg) {
-        wire.beginTransmission(0x68);
-        wire.write(alarmReg);
-
+    constexpr int deviceAddress      = 0x68;
+    constexpr uint8_t alarm1Reg      = 0x07;
+    constexpr uint8_t alarm2Reg      = 0x0B;
+    constexpr uint8_t controlReg     = 0x0E;
+    constexpr uint8_t statusReg      = 0x0F;
+    constexpr uint8_t intcnBit       = 0x04;
+    constexpr uint8_t rateSelectBits = 0x18;
+    constexpr uint8_t alarmFlagBits  = 0x03;
+    constexpr uint8_t oscStopFlagBit = 0x80;
+
+    uint8_t toBcd(uint8_t val) noexcept {
         uint8_t bcd{};
-
-        decToBcd(dateTime.second, bcd);
-        wire.write(bcd & 0x7F);
-
-        decToBcd(dateTime.minute, bcd);
-        wire.write(bcd & 0x7F);
-
-        decToBcd(dateTime.hour, bcd);
-        wire.write(bcd & 0x7F);
-
-        decToBcd(dateTime.day, bcd);
-        wire.write(bcd & 0x3F);
-
-        wire.endTransmission();
+        decToBcd(val, bcd);
+        return bcd;
     }
 
-    uint8_t readReg(TwoWire& wire, uint8_t reg) {
-        wire.beginTransmission(0x68);
-        wire.write(reg);
-        wire.endTransmission();
-
-        wire.requestFrom(0x68, 1);
-        return wire.read();
+    // Alarm 1 matches on seconds, minutes, hours and date.
+    void encodeAlarm1(uint8_t* regs, const DateTime& dateTime) noexcept {
+        regs[0] = toBcd(dateTime.second) & 0x7F;
+        regs[1] = toBcd(dateTime.minute) & 0x7F;
+        regs[2] = toBcd(dateTime.hour) & 0x7F;
+        regs[3] = toBcd(dateTime.day) & 0x3F;
     }
 
-    void setReg(TwoWire& wire, uint8_t reg, uint8_t value) {
-        wire.beginTransmission(0x68);
+    void readRegs(TwoWire& wire, uint8_t reg, uint8_t* data, size_t count) {
+        wire.beginTransmission(deviceAddress);
         wire.write(reg);
-        wire.write(value);
         wire.endTransmission();
-    }
 
-    void enableAlarm(TwoWire& wire, bool enable, uint8_t controlMask) {
-        auto control = readReg(wire, 0x0E);
-
-        if (enable) {
-            control |= controlMask;
-        } else {
-            control &= ~controlMask;
+        wire.requestFrom(deviceAddress, static_cast<int>(count));
+        for (size_t i = 0; i < count; ++i) {
+            data[i] = wire.read();
         }
-
-        setReg(wire, 0x0E, control);
-    }
-
-    bool checkAlarmTriggered(TwoWire& wire, uint8_t flagMask) {
-        const auto status = readReg(wire, 0x0F);
-        return (status & flagMask) != 0;
-    }
-
-    void clearAlarmFlag(TwoWire& wire, uint8_t flagMask) {
-        auto status = readReg(wire, 0x0F);
-        status &= ~flagMask;
-        setReg(wire, 0x0F, status);
     }
 } // namespace
 
@@ -80,14 +57,15 @@ DS3231::~DS3231() = default;
 
 void DS3231::begin() {
     wire_.begin();
+    readRegs(wire_, alarm1Reg, registers_.data(), registers_.size());
 }
 
 DateTime DS3231::getDateTime() {
-    wire_.beginTransmission(0x68);
+    wire_.beginTransmission(deviceAddress);
     wire_.write(0x00);
     wire_.endTransmission();
 
-    wire_.requestFrom(0x68, 7);
+    wire_.requestFrom(deviceAddress, 7);
 
     const auto second    = bcdToDec(wire_.read() & 0x7F);
     const auto minute    = bcdToDec(wire_.read());
@@ -101,7 +79,7 @@ DateTime DS3231::getDateTime() {
 }
 
 void DS3231::setDateTime(const DateTime& dateTime) {
-    wire_.beginTransmission(0x68);
+    wire_.beginTransmission(deviceAddress);
     wire_.write(0x00);
 
     uint8_t bcd{};
@@ -131,43 +109,109 @@ void DS3231::setDateTime(const DateTime& dateTime) {
 }
 
 void DS3231::enableAlarm1(bool enable) {
-    enableAlarm(wire_, enable, 0x01);
+    enableAlarm(enable, 0x01);
 }
 
 void DS3231::enableAlarm2(bool enable) {
-    enableAlarm(wire_, enable, 0x02);
+    enableAlarm(enable, 0x02);
 }
 
+// Enables the Alarm 1 interrupt along with the alarm time, in a single burst ending at the control register.
 void DS3231::setAlarm1(const DateTime& dateTime) {
-    setAlarm(wire_, dateTime, 0x07);
+    encodeAlarm1(&shadow(alarm1Reg), dateTime);
+    shadow(controlReg) |= intcnBit | 0x01;
 
-    wire_.beginTransmission(0x68);
-    wire_.write(0x0E);
-    wire_.write(0x05); // Enables Alarm 1 interrupt.
-    wire_.endTransmission();
+    writeShadow(alarm1Reg, controlReg);
 }
 
+// Alarm 2 has no seconds register and matches on minutes, hours and date.
 void DS3231::setAlarm2(const DateTime& dateTime) {
-    setAlarm(wire_, dateTime, 0x0B);
+    shadow(alarm2Reg)     = toBcd(dateTime.minute) & 0x7F;
+    shadow(alarm2Reg + 1) = toBcd(dateTime.hour) & 0x7F;
+    shadow(alarm2Reg + 2) = toBcd(dateTime.day) & 0x3F;
+    shadow(controlReg) |= intcnBit | 0x02;
 
-    wire_.beginTransmission(0x68);
-    wire_.write(0x0E);
-    wire_.write(0x06); // Enables Alarm 2 interrupt.
-    wire_.endTransmission();
+    writeShadow(alarm2Reg, controlReg);
 }
 
 bool DS3231::alarm1Triggered() {
-    return checkAlarmTriggered(wire_, 0x01);
+    readRegs(wire_, statusReg, &shadow(statusReg), 1);
+    return (shadow(statusReg) & 0x01) != 0;
 }
 
 bool DS3231::alarm2Triggered() {
-    return checkAlarmTriggered(wire_, 0x02);
+    readRegs(wire_, statusReg, &shadow(statusReg), 1);
+    return (shadow(statusReg) & 0x02) != 0;
 }
 
 void DS3231::clearAlarm1Flag() {
-    clearAlarmFlag(wire_, 0x01);
+    clearAlarmFlag(0x01);
 }
 
 void DS3231::clearAlarm2Flag() {
-    clearAlarmFlag(wire_, 0x02);
+    clearAlarmFlag(0x02);
+}
+
+// Programs Alarm 1, routes INT/SQW to the alarm interrupt and clears a pending Alarm 1 flag, all in one burst over
+// the alarm, control and status registers.
+void DS3231::armAlarm1(const DateTime& dateTime) {
+    encodeAlarm1(&shadow(alarm1Reg), dateTime);
+    shadow(controlReg) |= intcnBit | 0x01;
+
+    // Writing 1 leaves a flag untouched, so only the Alarm 1 flag is cleared.
+    const auto status = shadow(statusReg);
+
+    shadow(statusReg) = (status | oscStopFlagBit | alarmFlagBits) & ~0x01;
+    writeShadow(alarm1Reg, statusReg);
+    shadow(statusReg) = status & ~0x01;
+}
+
+// Switches the INT/SQW pin between the 1 Hz square wave and the alarm interrupt output. The falling edge of the
+// square wave marks the start of each second.
+void DS3231::enableSquareWave(bool enable) {
+    // RS2 and RS1 cleared selects 1 Hz.
+    const auto control = static_cast<uint8_t>(shadow(controlReg) & ~rateSelectBits);
+    const auto updated = static_cast<uint8_t>(enable ? control & ~intcnBit : control | intcnBit);
+
+    if (updated != shadow(controlReg)) {
+        shadow(controlReg) = updated;
+        writeShadow(controlReg, controlReg);
+    }
+}
+
+void DS3231::attachSquareWave(uint32_t pin, void (*handler)(uint32_t id, uint32_t event)) {
+    pinMode(pin, INPUT_IRQ_FALL);
+    digitalSetIrqHandler(pin, handler);
+}
+
+uint8_t& DS3231::shadow(uint8_t reg) {
+    return registers_[reg - alarm1Reg];
+}
+
+void DS3231::writeShadow(uint8_t firstReg, uint8_t lastReg) {
+    wire_.beginTransmission(deviceAddress);
+    wire_.write(firstReg);
+    for (auto reg = firstReg; reg <= lastReg; ++reg) {
+        wire_.write(shadow(reg));
+    }
+    wire_.endTransmission();
+}
+
+// Alarm flags can only be cleared, and writing 1 leaves them as they are, so no read is needed to keep the others.
+void DS3231::clearAlarmFlag(uint8_t flagMask) {
+    const auto status = shadow(statusReg);
+
+    shadow(statusReg) = (status | oscStopFlagBit | alarmFlagBits) & ~flagMask;
+    writeShadow(statusReg, statusReg);
+    shadow(statusReg) = status & ~flagMask;
+}
+
+void DS3231::enableAlarm(bool enable, uint8_t controlMask) {
+    const auto updated = static_cast<uint8_t>(enable ? shadow(controlReg) | controlMask
+                                                     : shadow(controlReg) & ~controlMask);
+
+    if (updated != shadow(controlReg)) {
+        shadow(controlReg) = updated;
+        writeShadow(controlReg, controlReg);
+    }
 }
@@ -2,6 +2,9 @@
 
 #include "DateTime.hpp"
 
+#include <array>
+#include <cstdint>
+
 class TwoWire;
 
 class DS3231 {
@@ -19,7 +22,18 @@ public:
     bool alarm2Triggered();
     void clearAlarm1Flag();
     void clearAlarm2Flag();
+    void armAlarm1(const DateTime& dateTime);
+    void enableSquareWave(bool enable);
+    void attachSquareWave(uint32_t pin, void (*handler)(uint32_t id, uint32_t event));
 
 private:
+    uint8_t& shadow(uint8_t reg);
+    void writeShadow(uint8_t firstReg, uint8_t lastReg);
+    void clearAlarmFlag(uint8_t flagMask);
+    void enableAlarm(bool enable, uint8_t controlMask);
+
     TwoWire& wire_;
+    // Copy of the alarm, control and status registers (0x07 to 0x0F), loaded by begin(). Only the alarm flags change
+    // behind our back, so they are the only bits read back from the device.
+    std::array<uint8_t, 9> registers_{};
 };
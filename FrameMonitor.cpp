@@ -0,0 +1,111 @@
+#include "FrameMonitor.hpp"
+
+#include <mmf2_module.h>
+
+namespace {
+    // The frame interval is tracked as an exponential moving average with a weight of 1/8, kept in 1/8 units.
+    constexpr uint32_t intervalAverageShift = 3;
+
+    enum frameMonitorModuleCommands {
+        frameMonitorModuleCmdSetOwner = MM_CMD_MODULE_BASE + 1,
+    };
+
+    struct frameMonitorContext {
+        FrameMonitor* owner{};
+    };
+
+    void* createFrameMonitorContext(void* parent) {
+        return new frameMonitorContext;
+    }
+
+    void* destroyFrameMonitorContext(void* ptr) {
+        if (const auto context = static_cast<frameMonitorContext*>(ptr)) {
+            delete context;
+        }
+
+        return nullptr;
+    }
+
+    int frameMonitorControllingHandler(void* ptr, int cmd, int arg) {
+        const auto context = static_cast<frameMonitorContext*>(ptr);
+
+        if (cmd == frameMonitorModuleCmdSetOwner) {
+            context->owner = reinterpret_cast<FrameMonitor*>(arg);
+        }
+
+        return {};
+    }
+
+    int frameMonitorDataHandler(void* ptr, void* input, void* output) {
+        const auto context = static_cast<frameMonitorContext*>(ptr);
+        const auto item    = static_cast<mm_queue_item_t*>(input);
+
+        if (context && item && context->owner) {
+            context->owner->handleFrame(
+                reinterpret_cast<const uint8_t*>(item->data_addr), item->size, item->timestamp);
+        }
+
+        return {};
+    }
+
+    mm_module_t frameMonitorModule = {
+        .create      = &createFrameMonitorContext,
+        .destroy     = &destroyFrameMonitorContext,
+        .control     = &frameMonitorControllingHandler,
+        .handle      = &frameMonitorDataHandler,
+        .output_type = MM_TYPE_NONE,
+        .module_type = MM_TYPE_VSINK,
+        .name        = "frame monitor module",
+    };
+} // namespace
+
+FrameMonitor::FrameMonitor() : bytes_{}, frames_{}, drops_{}, lastTimestamp_{}, averageInterval_{} {
+    _p_mmf_context = mm_module_open(&frameMonitorModule);
+    mm_module_ctrl(_p_mmf_context, frameMonitorModuleCmdSetOwner, reinterpret_cast<int32_t>(this));
+}
+
+FrameMonitor::~FrameMonitor() {
+    if (_p_mmf_context) {
+        mm_module_close(_p_mmf_context);
+        _p_mmf_context = nullptr;
+    }
+}
+
+uint32_t FrameMonitor::bytes() const noexcept {
+    return bytes_.load(std::memory_order_acquire);
+}
+
+uint32_t FrameMonitor::frames() const noexcept {
+    return frames_.load(std::memory_order_acquire);
+}
+
+uint32_t FrameMonitor::drops() const noexcept {
+    return drops_.load(std::memory_order_acquire);
+}
+
+void FrameMonitor::resetCounters() noexcept {
+    bytes_.store(0, std::memory_order_release);
+    frames_.store(0, std::memory_order_release);
+    drops_.store(0, std::memory_order_release);
+}
+
+void FrameMonitor::handleFrame(const uint8_t* data, uint32_t size, uint32_t timestamp) {
+    bytes_.fetch_add(size, std::memory_order_acq_rel);
+
+    // Frames are dropped upstream when a consumer such as the muxer holds the shared queue items for too long,
+    // which shows up here as gaps of whole frame intervals in the capture timestamps.
+    if (frames_.fetch_add(1, std::memory_order_acq_rel) != 0 && timestamp > lastTimestamp_) {
+        const auto interval = timestamp - lastTimestamp_;
+
+        if (averageInterval_ == 0) {
+            averageInterval_ = interval << intervalAverageShift;
+        } else if (const auto average = averageInterval_ >> intervalAverageShift;
+                   average != 0 && interval >= average * 2) {
+            drops_.fetch_add(interval / average - 1, std::memory_order_acq_rel);
+        } else {
+            averageInterval_ += interval - average;
+        }
+    }
+
+    lastTimestamp_ = timestamp;
+}
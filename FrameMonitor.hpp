@@ -0,0 +1,26 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <VideoStream.h>
+
+class FrameMonitor : public MMFModule {
+public:
+    FrameMonitor();
+    FrameMonitor(const FrameMonitor&) = delete;
+    ~FrameMonitor();
+    FrameMonitor& operator=(const FrameMonitor&) = delete;
+    uint32_t bytes() const noexcept;
+    uint32_t frames() const noexcept;
+    uint32_t drops() const noexcept;
+    void resetCounters() noexcept;
+    void handleFrame(const uint8_t* data, uint32_t size, uint32_t timestamp);
+
+private:
+    std::atomic_uint32_t bytes_;
+    std::atomic_uint32_t frames_;
+    std::atomic_uint32_t drops_;
+    uint32_t lastTimestamp_;
+    uint32_t averageInterval_;
+};
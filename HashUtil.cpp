@@ -0,0 +1,67 @@
+#include "HashUtil.hpp"
+
+#include <array>
+#include <cstddef>
+
+namespace {
+    constexpr uint32_t crc32Polynomial = 0xEDB88320;
+    constexpr size_t crc32SliceCount   = 8;
+
+    using Crc32Tables = std::array<std::array<uint32_t, 0x100>, crc32SliceCount>;
+
+    // Table `k` advances the CRC of a byte by `k` further zero bytes, so that slice-by-8 folds eight input bytes with
+    // eight independent lookups. The 8 KiB of tables are built at compile time and live in flash.
+    constexpr Crc32Tables makeCrc32Tables() noexcept {
+        Crc32Tables tables{};
+
+        for (uint32_t byte = 0; byte < 0x100; byte++) {
+            uint32_t crc = byte;
+
+            for (int bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (crc32Polynomial & (0U - (crc & 1)));
+            }
+
+            tables[0][byte] = crc;
+        }
+
+        for (size_t slice = 1; slice < crc32SliceCount; slice++) {
+            for (size_t byte = 0; byte < 0x100; byte++) {
+                const auto previous = tables[slice - 1][byte];
+                tables[slice][byte] = (previous >> 8) ^ tables[0][previous & 0xFF];
+            }
+        }
+
+        return tables;
+    }
+
+    constexpr Crc32Tables crc32Tables = makeCrc32Tables();
+
+    constexpr uint32_t readU32Le(const uint8_t* bytes) noexcept {
+        return static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8
+             | static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+    }
+} // namespace
+
+namespace HashUtil {
+    uint32_t crc32(std::span<const uint8_t> data, uint32_t crc) noexcept {
+        auto&& t    = crc32Tables;
+        auto bytes  = data.data();
+        auto remain = data.size();
+
+        crc = ~crc;
+
+        for (; remain >= crc32SliceCount; bytes += crc32SliceCount, remain -= crc32SliceCount) {
+            const auto low  = readU32Le(bytes) ^ crc;
+            const auto high = readU32Le(bytes + 4);
+
+            crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24]
+                ^ t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+        }
+
+        for (; remain > 0; bytes++, remain--) {
+            crc = (crc >> 8) ^ t[0][(crc ^ *bytes) & 0xFF];
+        }
+
+        return ~crc;
+    }
+} // namespace HashUtil
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
+#include <span>
 #include <string_view>
 
 #include <WString.h>
@@ -11,4 +13,7 @@ namespace HashUtil {
             return std::hash<std::string_view>{}(std::string_view{str.c_str(), str.length()});
         }
     };
+
+    // CRC-32 (IEEE 802.3, reflected). Pass the previous result as `crc` to continue over split data.
+    uint32_t crc32(std::span<const uint8_t> data, uint32_t crc = 0) noexcept;
 } // namespace HashUtil
@@ -3,6 +3,7 @@
 #include "HttpMessage.hpp"
 #include "HttpMessageServer.hpp"
 #include "HttpService.hpp"
+#include "IdlePowerManager.hpp"
 
 #if 1
 #include <FreeRTOS.h>
@@ -114,6 +115,8 @@ void HttpServer::acceptRoutine(ManagedTask::CheckStoppedHandler checkStopped) {
 
                 // Invokes the registered service.
                 if (currentLineIsBlank && c == '\n') {
+                    globalIdlePowerManager.noteActivity();
+
                     if (service) {
                         service->run(methodPath, message, client);
                     } else {
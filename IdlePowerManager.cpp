@@ -0,0 +1,256 @@
+#include "IdlePowerManager.hpp"
+
+#include "BootProfiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#include <Arduino.h>
+#include <LOGUARTClass.h>
+
+namespace {
+    constexpr uint32_t transitionGuardMs = 2000;
+    constexpr uint32_t minDwellMs        = 10 * 1000;
+
+    // Time since the last client request before each tier may be entered. The deep sleep threshold matches the delay
+    // the controller used to wait after boot before sleeping.
+    constexpr std::array<uint32_t, IdlePowerManager::tierCount> idleThresholdMs{
+        0,
+        30 * 1000,
+        2 * 60 * 1000,
+        10 * 60 * 1000,
+        15 * 60 * 1000,
+    };
+
+    // Assumed {entry, exit} latencies in microseconds until a transition has been measured. Deep sleep is left
+    // through a full boot, which the boot profiler measures instead.
+    constexpr std::array<std::pair<uint32_t, uint32_t>, IdlePowerManager::tierCount> defaultLatencyUs{{
+        {0, 0},
+        {50 * 1000, 50 * 1000},
+        {500 * 1000, 1500 * 1000},
+        {200 * 1000, 500 * 1000},
+        {1000 * 1000, 10 * 1000 * 1000},
+    }};
+
+    constexpr std::array<const char*, IdlePowerManager::tierCount> tierNames{
+        "full",
+        "reducedFps",
+        "encoderOff",
+        "radiosOff",
+        "deepSleep",
+    };
+
+    constexpr auto toIndex(PowerTier tier) noexcept {
+        return static_cast<size_t>(tier);
+    }
+
+    // Keeps the worst recent sample, decaying by an eighth per transition so that one slow outlier does not stick.
+    void recordSample(uint32_t& value, uint32_t sample) noexcept {
+        value = std::max(sample, value - value / 8);
+    }
+
+    // Boot time of the slowest remembered alarm wake, up to where it was ready for its first schedule check. Time
+    // spent waiting for the window to open is not part of it.
+    std::optional<uint32_t> measuredAlarmBootUs() {
+        std::optional<uint32_t> result;
+
+        for (auto&& record : globalBootProfiler.history()) {
+            if (record.alarmWake == 0) {
+                continue;
+            }
+
+            for (size_t i = 0; i < record.stageCount; i++) {
+                if (const auto name = record.stages[i].name.data();
+                    std::strcmp(name, "windowWait") == 0 || std::strcmp(name, "firstTick") == 0) {
+                    result = std::max(result.value_or(0), record.stages[i].startUs);
+                    break;
+                }
+            }
+        }
+
+        return result;
+    }
+} // namespace
+
+IdlePowerManager globalIdlePowerManager;
+
+IdlePowerManager::IdlePowerManager() {
+    for (size_t i = 0; i < tierCount; i++) {
+        latencies_[i] = {defaultLatencyUs[i].first, defaultLatencyUs[i].second};
+    }
+}
+
+void IdlePowerManager::setHandler(PowerTier tier, TierHandler handler) {
+    handlers_[toIndex(tier)] = std::move(handler);
+}
+
+void IdlePowerManager::noteActivity() noexcept {
+    lastActivityMs_.store(millis(), std::memory_order_relaxed);
+}
+
+// Leaves every tier above the target at once, but enters deeper tiers one per call so that each is measured on its
+// own and the next decision already sees its latency.
+PowerTier IdlePowerManager::update(std::optional<int64_t> secondsToNextStart, bool recording) {
+    const auto target = recording ? PowerTier::full : selectTier(secondsToNextStart);
+
+    while (tier_ > target) {
+        transition(tier_, false);
+        tier_ = static_cast<PowerTier>(toIndex(tier_) - 1);
+    }
+
+    if (tier_ < target) {
+        auto next = toIndex(tier_) + 1;
+
+        while (next < toIndex(target) && !handlers_[next]) {
+            next++;
+        }
+
+        tier_ = static_cast<PowerTier>(next);
+        transition(tier_, true);
+    }
+
+    return tier_;
+}
+
+// Steps back to the deepest tier below deep sleep when the controller does not arm the alarm after all, instead of
+// staying in deep sleep while awake and deciding again on every tick.
+void IdlePowerManager::cancelDeepSleep() {
+    if (tier_ != PowerTier::deepSleep) {
+        return;
+    }
+
+    transition(tier_, false);
+
+    auto previous = toIndex(tier_) - 1;
+
+    while (previous > 0 && !handlers_[previous]) {
+        previous--;
+    }
+
+    tier_ = static_cast<PowerTier>(previous);
+
+    Serial.print("Deep sleep cancelled, back to power tier ");
+    Serial.println(tierNames[previous]);
+}
+
+PowerTier IdlePowerManager::tier() const noexcept {
+    return tier_;
+}
+
+// Time from leaving `tier` until the camera and the encoder are back at full rate.
+uint32_t IdlePowerManager::wakeLatencyMs(PowerTier tier) const {
+    uint64_t result{};
+
+    if (tier == PowerTier::deepSleep) {
+        result = measuredAlarmBootUs().value_or(latencies_[toIndex(tier)].exitUs);
+    } else {
+        for (size_t i = 1; i <= toIndex(tier); i++) {
+            result += latencies_[i].exitUs;
+        }
+    }
+
+    return static_cast<uint32_t>((result + 999) / 1000);
+}
+
+// Returns how long the main loop may block before the tier has to change: a deeper tier's idle threshold passes, or
+// the next recording comes within the wake latency of the current tier.
+uint32_t IdlePowerManager::nextDecisionMs(std::optional<int64_t> secondsToNextStart) const {
+    if (selectTier(secondsToNextStart) != tier_) {
+        return 0;
+    }
+
+    const auto idleMs = millis() - lastActivityMs_.load(std::memory_order_relaxed);
+    auto result       = std::numeric_limits<uint32_t>::max();
+
+    for (auto i = toIndex(tier_) + 1; i < tierCount; i++) {
+        if (idleMs < idleThresholdMs[i]) {
+            result = std::min(result, idleThresholdMs[i] - idleMs);
+        }
+    }
+
+    if (tier_ != PowerTier::full && secondsToNextStart) {
+        const auto budgetMs  = std::max<int64_t>(*secondsToNextStart, 0) * 1000;
+        const auto requireMs = static_cast<int64_t>(wakeLatencyMs(tier_)) + transitionGuardMs;
+
+        result = static_cast<uint32_t>(std::clamp<int64_t>(budgetMs - requireMs, 0, result));
+    }
+
+    return result;
+}
+
+void IdlePowerManager::dump() const {
+    Serial.print("Power tier: ");
+    Serial.println(tierNames[toIndex(tier_)]);
+
+    for (size_t i = 1; i < tierCount; i++) {
+        Serial.print("  ");
+        Serial.print(tierNames[i]);
+        Serial.print(": entry ");
+        Serial.print(latencies_[i].entryUs);
+        Serial.print(" us, wake ");
+        Serial.print(wakeLatencyMs(static_cast<PowerTier>(i)));
+        Serial.println(" ms");
+    }
+}
+
+// Picks the deepest tier whose idle threshold has passed and that can still be left before the next recording
+// starts. Entering a tier also has to pay for its entry latency and a minimum dwell, so that a tier is not entered
+// only to be left again right away.
+PowerTier IdlePowerManager::selectTier(std::optional<int64_t> secondsToNextStart) const {
+    const auto idleMs   = millis() - lastActivityMs_.load(std::memory_order_relaxed);
+    const auto budgetMs = secondsToNextStart ? std::max<int64_t>(*secondsToNextStart, 0) * 1000
+                                             : std::numeric_limits<int64_t>::max();
+
+    for (auto i = tierCount - 1; i > 0; i--) {
+        const auto tier = static_cast<PowerTier>(i);
+
+        if (idleMs < idleThresholdMs[i] || (!handlers_[i] && tier != PowerTier::deepSleep)) {
+            continue;
+        }
+
+        auto requiredMs = static_cast<int64_t>(wakeLatencyMs(tier)) + transitionGuardMs;
+
+        if (tier > tier_) {
+            for (auto j = toIndex(tier_) + 1; j <= i; j++) {
+                requiredMs += latencies_[j].entryUs / 1000;
+            }
+
+            requiredMs += minDwellMs;
+        }
+
+        if (tier == PowerTier::deepSleep) {
+            requiredMs = std::max(requiredMs, (minDeepSleepSec + 1) * 1000);
+        }
+
+        if (budgetMs >= requiredMs) {
+            return tier;
+        }
+    }
+
+    return PowerTier::full;
+}
+
+void IdlePowerManager::transition(PowerTier tier, bool enter) {
+    auto&& handler = handlers_[toIndex(tier)];
+
+    if (!handler) {
+        return;
+    }
+
+    const auto start = micros();
+
+    handler(enter);
+
+    const auto elapsedUs = micros() - start;
+    auto&& latency       = latencies_[toIndex(tier)];
+
+    recordSample(enter ? latency.entryUs : latency.exitUs, elapsedUs);
+
+    Serial.print(enter ? "Entered power tier " : "Left power tier ");
+    Serial.print(tierNames[toIndex(tier)]);
+    Serial.print(" in ");
+    Serial.print(elapsedUs);
+    Serial.println(" us");
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "CommonTypes.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+// Steps the device down through the power tiers between recordings. A tier is entered once no client has been seen
+// for its idle threshold and the next recording is far enough away to leave it again in time. The entry and exit
+// latencies of every tier are measured on each transition and feed back into that decision. Everything except
+// `noteActivity` runs on the main loop.
+class IdlePowerManager {
+public:
+    using TierHandler = std::function<void(bool enter)>;
+
+    static constexpr size_t tierCount = static_cast<size_t>(PowerTier::deepSleep) + 1;
+
+    // Deep sleep is not worth an alarm for a shorter wait, the controller stays up instead.
+    static constexpr int64_t minDeepSleepSec = 60;
+
+    IdlePowerManager();
+    void setHandler(PowerTier tier, TierHandler handler);
+    void noteActivity() noexcept;
+    PowerTier update(std::optional<int64_t> secondsToNextStart, bool recording);
+    void cancelDeepSleep();
+    PowerTier tier() const noexcept;
+    uint32_t wakeLatencyMs(PowerTier tier) const;
+    uint32_t nextDecisionMs(std::optional<int64_t> secondsToNextStart) const;
+    void dump() const;
+
+private:
+    struct Latency {
+        uint32_t entryUs{};
+        uint32_t exitUs{};
+    };
+
+    PowerTier selectTier(std::optional<int64_t> secondsToNextStart) const;
+    void transition(PowerTier tier, bool enter);
+
+    std::array<TierHandler, tierCount> handlers_;
+    std::array<Latency, tierCount> latencies_;
+    std::atomic<uint32_t> lastActivityMs_{};
+    PowerTier tier_{PowerTier::full};
+};
+
+extern IdlePowerManager globalIdlePowerManager;
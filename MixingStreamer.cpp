@@ -1,12 +1,19 @@
 #include "MixingStreamer.hpp"
 
 #include "DateTime.hpp"
+#include "FrameMonitor.hpp"
+#include "RecordingTelemetry.hpp"
 #include "Resources.hpp"
+#include "StorageUtil.hpp"
 #include "TimeUtil.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
 #include <cstdio>
 #include <optional>
+#include <utility>
+#include <vector>
 
 #if 1
 #undef dbg_printf
@@ -19,15 +26,94 @@
 #include <MP4Recording.h>
 #include <StreamIO.h>
 #include <VideoStream.h>
+#include <semphr.h>
 
 namespace {
     constexpr uint32_t defaultSingleFileDuration = 60 * 30;
     constexpr char defaultBaseFileName[]         = "recording";
+    // Encoder default of the FHD preset on channel 0, the ceiling the bitrate fallback recovers to.
+    constexpr uint32_t configuredBitrate         = 2 * 1024 * 1024;
+
+    // The MP4 module keeps its own duration limit, which must never win over the rotation policies.
+    constexpr uint32_t moduleDurationMarginSec = 10;
+
+    // The bitrate is lowered one step when at least `fallbackTriggerTicks` of `fallbackWindowTicks` consecutive
+    // ticks saw a slow write or dropped frames. It is raised one step back towards the configured bitrate only after
+    // `recoveryWindows` windows in a row whose writes all stayed under `fastLatencyMs`, so that a card hovering around
+    // the threshold does not make the bitrate oscillate. Either change happens at most once per `bitrateCooldownMs`.
+    constexpr uint32_t slowLatencyMs          = 250;
+    constexpr uint32_t fastLatencyMs          = 100;
+    constexpr uint32_t fallbackWindowTicks    = 10;
+    constexpr uint32_t fallbackTriggerTicks   = 5;
+    constexpr uint32_t recoveryWindows        = 6;
+    constexpr uint32_t bitrateCooldownMs      = 30 * 1000;
+    constexpr uint32_t fallbackStepPercent    = 75;
+    constexpr uint32_t minimumFallbackBitrate = 512 * 1024;
+
+    // The MP4 module writes every frame to the card from its data handler on the MMF task. That handler is wrapped,
+    // so each write is timed where it happens, and the slowest one since the last tick is kept for the fallback.
+    int (*muxerHandler)(void*, void*, void*) = nullptr;
+    mm_module_t timedMuxerModule{};
+    std::atomic_uint32_t slowestWriteMs{};
+
+    int timedMuxerHandler(void* ptr, void* input, void* output) {
+        const auto writeStart = millis();
+        const auto result     = muxerHandler(ptr, input, output);
+        const auto latency    = millis() - writeStart;
+        auto slowest          = slowestWriteMs.load(std::memory_order_relaxed);
+
+        while (latency > slowest
+               && !slowestWriteMs.compare_exchange_weak(slowest, latency, std::memory_order_relaxed)) {
+        }
+
+        globalRecordingTelemetry.recordLatency(latency);
+
+        return result;
+    }
+
+    // Swaps the handler in the MMF context of the MP4 module for `timedMuxerHandler`. This relies on the layout of
+    // `mm_context_t` and `mm_module_t` in the realtek:AmebaPro2 4.1.0-build20251027 core pinned in sketch.yaml, where
+    // the context points to a module table whose `handle` the MMF task calls with every frame; check it again before
+    // moving to another core. Without the hook recording still works, only the bitrate fallback never sees a slow
+    // write, which is reported once.
+    void timeWrites(MMFModule& muxer) {
+        static bool reported{};
+        const auto context = muxer._p_mmf_context;
+
+        if (context && context->module == &timedMuxerModule) {
+            return;
+        }
+
+        if (!context || !context->module || !context->module->handle) {
+            if (!reported) {
+                reported = true;
+                Serial.println("MP4 module has no MMF handler to wrap, write latency is not measured.");
+            }
+
+            return;
+        }
+
+        muxerHandler            = context->module->handle;
+        timedMuxerModule        = *context->module;
+        timedMuxerModule.handle = &timedMuxerHandler;
+        context->module         = &timedMuxerModule;
+    }
 } // namespace
 
 class MixingStreamer::impl {
 public:
-    impl() : index_{}, baseFileName_{defaultBaseFileName}, startTime_{}, avMixStreamer_{1, 2} {}
+    impl()
+        : index_{}, baseFileName_{defaultBaseFileName}, directoryLayout_{DirectoryLayout::daily},
+          bitrate_{configuredBitrate}, singleFileDuration_{defaultSingleFileDuration}, keyframeAligned_{},
+          lastTickTime_{}, windowTicks_{}, slowTicks_{}, windowSlowestMs_{}, cleanWindows_{}, reportedDrops_{},
+          lastBitrateChange_{}, startTime_{}, mutex_{xSemaphoreCreateRecursiveMutex()}, avMixStreamer_{1, 3} {}
+
+    ~impl() {
+        if (mutex_) {
+            vSemaphoreDelete(mutex_);
+            mutex_ = nullptr;
+        }
+    }
 
     void init(MMFModule videoInput, MMFModule mixedOutput, VideoSetting& videoSetting) {
         reset();
@@ -35,10 +121,13 @@ public:
         mp4_.configVideo(videoSetting);
         mp4_.setRecordingFileCount(1);
         mp4_.setRecordingDataType(STORAGE_VIDEO);
+        timeWrites(mp4_);
+        globalRecordingTelemetry.setBitrate(bitrate_);
 
         avMixStreamer_.registerInput(videoInput);
         avMixStreamer_.registerOutput1(mixedOutput);
         avMixStreamer_.registerOutput2(mp4_);
+        avMixStreamer_.registerOutput3(frameMonitor_);
 
         if (avMixStreamer_.begin() != 0) {
             Serial.println("Mixed StreamIO link start failed.");
@@ -51,14 +140,16 @@ public:
     }
 
     uint32_t singleFileDuration() {
-        return mp4_.getRecordingDuration();
+        return singleFileDuration_;
     }
 
     void setSingleFileDuration(uint32_t value) {
         if (value == 0) {
             ++value;
         }
-        mp4_.setRecordingDuration(value);
+
+        singleFileDuration_ = value;
+        mp4_.setRecordingDuration(value + moduleDurationMarginSec);
     }
 
     String baseFileName() {
@@ -69,21 +160,93 @@ public:
         baseFileName_ = value;
     }
 
+    DirectoryLayout directoryLayout() {
+        return directoryLayout_;
+    }
+
+    void setDirectoryLayout(DirectoryLayout value) {
+        directoryLayout_ = value;
+    }
+
+    bool keyframeAligned() {
+        return keyframeAligned_;
+    }
+
+    void setKeyframeAligned(bool value) {
+        xSemaphoreTakeRecursive(mutex_, portMAX_DELAY);
+        keyframeAligned_ = value;
+        xSemaphoreGiveRecursive(mutex_);
+    }
+
+    void addRotationPolicy(std::unique_ptr<RotationPolicy> policy) {
+        xSemaphoreTakeRecursive(mutex_, portMAX_DELAY);
+        rotationPolicies_.emplace_back(std::move(policy));
+        xSemaphoreGiveRecursive(mutex_);
+    }
+
+    void clearRotationPolicies() {
+        xSemaphoreTakeRecursive(mutex_, portMAX_DELAY);
+        rotationPolicies_.clear();
+        xSemaphoreGiveRecursive(mutex_);
+    }
+
     void startRecording(int64_t timestamp) {
+        xSemaphoreTakeRecursive(mutex_, portMAX_DELAY);
         stopRecording(timestamp);
 
         lastTimestamp_.reset();
         startTime_ = TimeUtil::toDateTime(timestamp);
-        increaseFileName(true);
-        mp4_.begin();
+        beginSegment(timestamp, true);
         tick(timestamp);
+        xSemaphoreGiveRecursive(mutex_);
+    }
+
+    // Continues an interrupted session: segment names keep the session start time and count on from `segmentIndex`.
+    void resumeRecording(int64_t timestamp, int64_t sessionStart, uint32_t segmentIndex) {
+        xSemaphoreTakeRecursive(mutex_, portMAX_DELAY);
+        stopRecording(timestamp);
+
+        lastTimestamp_.reset();
+        startTime_        = TimeUtil::toDateTime(sessionStart);
+        index_            = segmentIndex;
+        currentDirectory_ = String{};
+        beginSegment(timestamp);
+        tick(timestamp);
+        xSemaphoreGiveRecursive(mutex_);
+    }
+
+    bool recording() {
+        xSemaphoreTakeRecursive(mutex_, portMAX_DELAY);
+        const auto result = mp4_.getRecordingState();
+        xSemaphoreGiveRecursive(mutex_);
+        return result;
+    }
+
+    uint32_t segmentIndex() {
+        xSemaphoreTakeRecursive(mutex_, portMAX_DELAY);
+        const auto result = static_cast<uint32_t>(index_);
+        xSemaphoreGiveRecursive(mutex_);
+
+        return result;
+    }
+
+    String currentSegment() {
+        xSemaphoreTakeRecursive(mutex_, portMAX_DELAY);
+        auto result = mp4_.getRecordingState() ? mp4_.getRecordingFileName() + ".mp4" : String{};
+        xSemaphoreGiveRecursive(mutex_);
+
+        return result;
     }
 
     bool stopRecording(int64_t timestamp) {
         static DateTime dateTime;
         static char filePath[256];
 
+        xSemaphoreTakeRecursive(mutex_, portMAX_DELAY);
+
         if (mp4_.getRecordingState()) {
+            const auto finalizeStart = millis();
+
             mp4_.end();
 
             while (mp4_.getRecordingState()) {
@@ -94,7 +257,8 @@ public:
                 filePath, sizeof(filePath), "%s%s.mp4", SDFs.getRootPath(), mp4_.getRecordingFileName().c_str());
 
             if (SDFs.exists(filePath)) {
-                dateTime = TimeUtil::toDateTime(timestamp);
+                const auto relativePath = mp4_.getRecordingFileName() + ".mp4";
+                dateTime                = TimeUtil::toDateTime(timestamp);
 
                 // Waiting for the file to be closed by the MP4 module.
                 while (SDFs.setLastModTime(filePath, dateTime.year, dateTime.month, dateTime.day, dateTime.hour,
@@ -103,49 +267,213 @@ public:
                     vTaskDelay(3 / portTICK_RATE_MS);
                 }
 
+                // Closing flushes the muxer buffers and writes the index, the longest write of every segment.
+                globalRecordingTelemetry.recordLatency(millis() - finalizeStart);
+
                 Serial.print("Set Last Modification Time: ");
                 Serial.println(filePath);
+
+                if (onSegmentFinalized_) {
+                    onSegmentFinalized_(relativePath);
+                }
             }
 
+            recordDrops();
+            globalRecordingTelemetry.endSegment(frameMonitor_.bytes());
+            xSemaphoreGiveRecursive(mutex_);
+
             return true;
         }
 
+        xSemaphoreGiveRecursive(mutex_);
+
         return false;
     }
 
     void tick(int64_t timestamp) {
+        xSemaphoreTakeRecursive(mutex_, portMAX_DELAY);
+
         if (!lastTimestamp_) {
             lastTimestamp_.emplace(timestamp);
         }
 
-        if (timestamp - *lastTimestamp_ >= singleFileDuration()) {
-            stopRecording(timestamp);
-            increaseFileName();
-            mp4_.begin();
-            lastTimestamp_.emplace(timestamp);
+        lastTickTime_ = millis();
+
+        adaptBitrate();
+
+        if (rotationDue(timestamp)) {
+            rotate(timestamp);
         }
+
+        xSemaphoreGiveRecursive(mutex_);
+    }
+
+    void onSegmentFinalized(SegmentHandler handler) {
+        onSegmentFinalized_ = std::move(handler);
+    }
+
+    void onBitrateChange(BitrateHandler handler) {
+        onBitrateChange_ = std::move(handler);
+    }
+
+    void onKeyframeRequest(KeyframeHandler handler) {
+        onKeyframeRequest_ = std::move(handler);
     }
 
 private:
-    void increaseFileName(bool reset = false) {
-        static char fileName[128];
+    bool rotationDue(int64_t timestamp) {
+        const SegmentProgress progress{
+            .startTimestamp = *lastTimestamp_,
+            .timestamp      = timestamp,
+            .bytes          = frameMonitor_.bytes(),
+        };
+
+        if (rotationPolicies_.empty()) {
+            return timestamp - *lastTimestamp_ >= singleFileDuration_;
+        }
+
+        return std::ranges::any_of(rotationPolicies_, [&](auto&& item) { return item->shouldRotate(progress); });
+    }
+
+    uint32_t recordDrops() {
+        const auto drops = frameMonitor_.drops();
+        const auto delta = drops - reportedDrops_;
+
+        if (delta != 0) {
+            globalRecordingTelemetry.recordOverflows(delta);
+            reportedDrops_ = drops;
+        }
+
+        return delta;
+    }
+
+    // Evaluated once per tick on the slowest muxer write since the previous tick.
+    void adaptBitrate() {
+        const auto latency = slowestWriteMs.exchange(0, std::memory_order_relaxed);
+
+        if (!mp4_.getRecordingState()) {
+            return;
+        }
+
+        if (latency >= slowLatencyMs || recordDrops() != 0) {
+            ++slowTicks_;
+        }
+
+        windowSlowestMs_ = std::max(windowSlowestMs_, latency);
+
+        if (++windowTicks_ < fallbackWindowTicks) {
+            return;
+        }
+
+        const auto settled = lastTickTime_ - lastBitrateChange_ >= bitrateCooldownMs;
+
+        if (slowTicks_ >= fallbackTriggerTicks) {
+            cleanWindows_ = 0;
+
+            if (settled && bitrate_ > minimumFallbackBitrate) {
+                Serial.print("SD card cannot keep up (");
+                Serial.print(slowTicks_);
+                Serial.print(" of ");
+                Serial.print(windowTicks_);
+                Serial.print(" ticks slow), lowering bitrate to ");
+                changeBitrate(std::max(bitrate_ / 100 * fallbackStepPercent, minimumFallbackBitrate), true);
+            }
+        } else if (slowTicks_ != 0 || windowSlowestMs_ >= fastLatencyMs) {
+            cleanWindows_ = 0;
+        } else if (++cleanWindows_ >= recoveryWindows && settled && bitrate_ < configuredBitrate) {
+            const auto raised = static_cast<uint64_t>(bitrate_) * 100 / fallbackStepPercent;
+
+            Serial.print("SD card keeps up again, raising bitrate to ");
+            changeBitrate(static_cast<uint32_t>(std::min<uint64_t>(raised, configuredBitrate)), false);
+        }
+
+        windowTicks_     = 0;
+        slowTicks_       = 0;
+        windowSlowestMs_ = 0;
+    }
+
+    void changeBitrate(uint32_t bitrate, bool fallback) {
+        bitrate_           = bitrate;
+        lastBitrateChange_ = lastTickTime_;
+        cleanWindows_      = 0;
+
+        Serial.println(bitrate_);
+        globalRecordingTelemetry.setBitrate(bitrate_, fallback);
+
+        if (onBitrateChange_) {
+            onBitrateChange_(bitrate_);
+        }
+    }
+
+    void rotate(int64_t timestamp) {
+        stopRecording(timestamp);
+        beginSegment(timestamp);
+        lastTimestamp_.emplace(timestamp);
+    }
+
+    void beginSegment(int64_t timestamp, bool reset = false) {
+        increaseFileName(timestamp, reset);
+
+        frameMonitor_.resetCounters();
+        reportedDrops_ = 0;
+        globalRecordingTelemetry.beginSegment();
+        mp4_.begin();
+
+        // The new segment is open before the encoder is asked for an IDR frame, so that frame is the first one the
+        // muxer writes instead of the segment starting mid-GOP.
+        if (keyframeAligned_ && onKeyframeRequest_) {
+            onKeyframeRequest_();
+        }
+    }
+
+    void increaseFileName(int64_t timestamp, bool reset = false) {
+        static char fileName[160];
 
         if (reset) {
             index_ = {};
         }
 
-        std::snprintf(fileName, sizeof(fileName), "%s_%04u-%02u-%02uT%02u-%02u-%02u_%u", baseFileName_.c_str(),
-            startTime_.year, startTime_.month, startTime_.day, startTime_.hour, startTime_.minute, startTime_.second,
-            index_++);
+        // Segments are sharded by their own start time, so a session crossing midnight continues in the next
+        // directory. The directory is only probed when it changes, keeping rotation free of extra lookups.
+        if (auto directory = StorageUtil::toSegmentDirectory(directoryLayout_, TimeUtil::toDateTime(timestamp));
+            directory != currentDirectory_ || reset) {
+            if (!StorageUtil::createDirectories(SDFs, directory)) {
+                directory = String{};
+            }
+
+            currentDirectory_ = std::move(directory);
+        }
+
+        std::snprintf(fileName, sizeof(fileName), "%s%s%s_%04u-%02u-%02uT%02u-%02u-%02u_%u", currentDirectory_.c_str(),
+            currentDirectory_.length() != 0 ? "/" : "", baseFileName_.c_str(), startTime_.year, startTime_.month,
+            startTime_.day, startTime_.hour, startTime_.minute, startTime_.second, index_++);
         mp4_.setRecordingFileName(fileName);
     }
 
     size_t index_;
     String baseFileName_;
+    String currentDirectory_;
+    DirectoryLayout directoryLayout_;
+    uint32_t bitrate_;
+    uint32_t singleFileDuration_;
+    bool keyframeAligned_;
+    uint32_t lastTickTime_;
+    uint32_t windowTicks_;
+    uint32_t slowTicks_;
+    uint32_t windowSlowestMs_;
+    uint32_t cleanWindows_;
+    uint32_t reportedDrops_;
+    uint32_t lastBitrateChange_;
     DateTime startTime_;
     std::optional<int64_t> lastTimestamp_;
+    std::vector<std::unique_ptr<RotationPolicy>> rotationPolicies_;
+    SegmentHandler onSegmentFinalized_;
+    BitrateHandler onBitrateChange_;
+    KeyframeHandler onKeyframeRequest_;
+    SemaphoreHandle_t mutex_;
 
     MP4Recording mp4_;
+    FrameMonitor frameMonitor_;
     StreamIO avMixStreamer_;
 };
 
@@ -181,10 +509,50 @@ void MixingStreamer::setBaseFileName(const String& value) const {
     impl_->setBaseFileName(value);
 }
 
+DirectoryLayout MixingStreamer::directoryLayout() const {
+    return impl_->directoryLayout();
+}
+
+void MixingStreamer::setDirectoryLayout(DirectoryLayout value) const {
+    impl_->setDirectoryLayout(value);
+}
+
+bool MixingStreamer::keyframeAligned() const {
+    return impl_->keyframeAligned();
+}
+
+void MixingStreamer::setKeyframeAligned(bool value) const {
+    impl_->setKeyframeAligned(value);
+}
+
+void MixingStreamer::addRotationPolicy(std::unique_ptr<RotationPolicy> policy) const {
+    impl_->addRotationPolicy(std::move(policy));
+}
+
+void MixingStreamer::clearRotationPolicies() const {
+    impl_->clearRotationPolicies();
+}
+
 void MixingStreamer::startRecording(int64_t timestamp) const {
     impl_->startRecording(timestamp);
 }
 
+void MixingStreamer::resumeRecording(int64_t timestamp, int64_t sessionStart, uint32_t segmentIndex) const {
+    impl_->resumeRecording(timestamp, sessionStart, segmentIndex);
+}
+
+bool MixingStreamer::recording() const {
+    return impl_->recording();
+}
+
+uint32_t MixingStreamer::segmentIndex() const {
+    return impl_->segmentIndex();
+}
+
+String MixingStreamer::currentSegment() const {
+    return impl_->currentSegment();
+}
+
 bool MixingStreamer::stopRecording(int64_t timestamp) const {
     return impl_->stopRecording(timestamp);
 }
@@ -192,3 +560,15 @@ bool MixingStreamer::stopRecording(int64_t timestamp) const {
 void MixingStreamer::tick(int64_t timestamp) const {
     impl_->tick(timestamp);
 }
+
+void MixingStreamer::onSegmentFinalized(SegmentHandler handler) const {
+    impl_->onSegmentFinalized(std::move(handler));
+}
+
+void MixingStreamer::onBitrateChange(BitrateHandler handler) const {
+    impl_->onBitrateChange(std::move(handler));
+}
+
+void MixingStreamer::onKeyframeRequest(KeyframeHandler handler) const {
+    impl_->onKeyframeRequest(std::move(handler));
+}
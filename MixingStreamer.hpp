@@ -1,6 +1,10 @@
 #pragma once
 
+#include "CommonTypes.hpp"
+#include "RotationPolicy.hpp"
+
 #include <cstdint>
+#include <functional>
 #include <memory>
 
 #include <WString.h>
@@ -10,6 +14,10 @@ class VideoSetting;
 
 class MixingStreamer {
 public:
+    using SegmentHandler  = std::function<void(const String& relativePath)>;
+    using BitrateHandler  = std::function<void(uint32_t bitrate)>;
+    using KeyframeHandler = std::function<void()>;
+
     MixingStreamer();
     MixingStreamer(MixingStreamer&&) noexcept;
     ~MixingStreamer();
@@ -20,9 +28,22 @@ public:
     void setSingleFileDuration(uint32_t value) const;
     String baseFileName()const;
     void setBaseFileName(const String& value)const;
+    DirectoryLayout directoryLayout() const;
+    void setDirectoryLayout(DirectoryLayout value) const;
+    bool keyframeAligned() const;
+    void setKeyframeAligned(bool value) const;
+    void addRotationPolicy(std::unique_ptr<RotationPolicy> policy) const;
+    void clearRotationPolicies() const;
     void startRecording(int64_t timestamp)const;
+    void resumeRecording(int64_t timestamp, int64_t sessionStart, uint32_t segmentIndex) const;
+    bool recording() const;
+    uint32_t segmentIndex() const;
+    String currentSegment() const;
     bool stopRecording(int64_t timestamp)const;
     void tick(int64_t timestamp)const;
+    void onSegmentFinalized(SegmentHandler handler) const;
+    void onBitrateChange(BitrateHandler handler) const;
+    void onKeyframeRequest(KeyframeHandler handler) const;
 
 private:
     class impl;
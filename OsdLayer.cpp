@@ -0,0 +1,61 @@
+#include "OsdLayer.hpp"
+
+#include <LOGUARTClass.h>
+#include <VideoStreamOverlay.h>
+
+OsdLayer::OsdLayer(int32_t channel) : channel_{channel}, count_{} {}
+
+// Returns the index of the new field, which is also the OSD block it is drawn into, or nothing once every block is
+// taken.
+std::optional<size_t> OsdLayer::addField(int32_t x, int32_t y, uint32_t color) {
+    if (count_ == fields_.size()) {
+        Serial.print("OSD has no block left for a field at ");
+        Serial.print(x);
+        Serial.print(", ");
+        Serial.println(y);
+        return std::nullopt;
+    }
+
+    fields_[count_] = {
+        .x     = x,
+        .y     = y,
+        .color = color,
+    };
+
+    return count_++;
+}
+
+void OsdLayer::setText(size_t field, const String& text) {
+    if (auto&& item = fields_[field]; item.text != text) {
+        item.text  = text;
+        item.dirty = true;
+    }
+}
+
+void OsdLayer::setColor(size_t field, uint32_t color) {
+    if (auto&& item = fields_[field]; item.color != color) {
+        item.color = color;
+        item.dirty = true;
+    }
+}
+
+void OsdLayer::render() {
+    for (size_t i = 0; i < count_; i++) {
+        auto&& item = fields_[i];
+
+        if (!item.dirty) {
+            continue;
+        }
+
+        const auto block = static_cast<int>(i);
+
+        OSD.createBitmap(channel_, block);
+
+        if (item.text.length() != 0) {
+            OSD.drawText(channel_, item.x, item.y, item.text.c_str(), item.color, block);
+        }
+
+        OSD.update(channel_, block);
+        item.dirty = false;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include <WString.h>
+
+// Splits the overlay of a video channel into independent text fields, each backed by its own OSD block, and only
+// redraws the blocks whose text changed.
+class OsdLayer {
+public:
+    static constexpr size_t maxFieldCount = 6;
+
+    explicit OsdLayer(int32_t channel);
+    std::optional<size_t> addField(int32_t x, int32_t y, uint32_t color);
+    void setText(size_t field, const String& text);
+    void setColor(size_t field, uint32_t color);
+    void render();
+
+private:
+    struct Field {
+        int32_t x{};
+        int32_t y{};
+        uint32_t color{};
+        String text;
+        bool dirty{};
+    };
+
+    int32_t channel_;
+    std::array<Field, maxFieldCount> fields_;
+    size_t count_;
+};
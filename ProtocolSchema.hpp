@@ -0,0 +1,126 @@
+// Generated by tools/generate_protocol.py from tools/protocol.json. Do not edit.
+#pragma once
+
+#include "TlvSchema.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include <WString.h>
+
+namespace Protocol {
+    // Persisted configuration and schedule response. Schedule requests only set `schedule` and `rules`.
+    using AppConfigSchema = TlvSchema::Schema<
+        TlvSchema::Field<1, [](auto& message) -> auto& { return message.hotspot.enabled; }, TlvSchema::As<uint8_t>>,
+        TlvSchema::StringField<2, [](auto& message) -> auto& { return message.hotspot.ssid; }, 12>,
+        TlvSchema::StringField<3, [](auto& message) -> auto& { return message.hotspot.password; }, 8>,
+        TlvSchema::StringField<4, [](auto& message) -> auto& { return message.recording.baseName; }, 12>,
+        TlvSchema::Field<5, [](auto& message) -> auto& { return message.recording.singleFileDuration; },
+            TlvSchema::As<uint32_t>>,
+        TlvSchema::Field<6, [](auto& message) -> auto& { return message.recording.directoryLayout; },
+            TlvSchema::As<uint8_t>>,
+        TlvSchema::Field<7, [](auto& message) -> auto& { return message.recording.minFreeSpaceMb; },
+            TlvSchema::As<uint32_t>>,
+        TlvSchema::Field<8, [](auto& message) -> auto& { return message.recording.rotation.maxSegmentSizeMb; },
+            TlvSchema::As<uint32_t>>,
+        TlvSchema::Field<9, [](auto& message) -> auto& { return message.recording.rotation.alignmentSec; },
+            TlvSchema::As<uint32_t>>,
+        TlvSchema::Field<10, [](auto& message) -> auto& { return message.recording.rotation.keyframeAligned; },
+            TlvSchema::As<uint8_t>>,
+        TlvSchema::Field<11, [](auto& message) -> auto& { return message.clock.resyncSec; }, TlvSchema::As<uint32_t>>,
+        TlvSchema::Repeated<100, 2, 8, [](auto& message) -> auto& { return message.recording.schedule; },
+            TlvSchema::Field<0, [](auto& item) -> auto& { return item.startTimestamp; }, TlvSchema::As<uint64_t>>,
+            TlvSchema::Field<1, [](auto& item) -> auto& { return item.duration; }, TlvSchema::As<uint32_t>>>,
+        TlvSchema::Repeated<150, 3, 8, [](auto& message) -> auto& { return message.recording.rules; },
+            TlvSchema::Field<0, [](auto& item) -> auto& { return item.anchorTimestamp; }, TlvSchema::As<uint64_t>>,
+            TlvSchema::Field<1, [](auto& item) -> auto& { return item.duration; }, TlvSchema::As<uint32_t>>,
+            TlvSchema::Field<2, [](auto& item) -> auto& { return item; },
+                TlvSchema::Packed<uint32_t,
+                    TlvSchema::Bits<[](auto& item) -> auto& { return item.kind; }, 8>,
+                    TlvSchema::Bits<[](auto& item) -> auto& { return item.weekdayMask; }, 8>,
+                    TlvSchema::Bits<[](auto& item) -> auto& { return item.intervalHours; }, 16>>>>>;
+
+    enum class AppConfigSection : uint8_t {
+        hotspot,
+        storage,
+        rotation,
+        clock,
+        schedule,
+    };
+
+    inline constexpr size_t appConfigSectionCount = 5;
+
+    // The section owning a record type, or nothing for types outside the message.
+    constexpr std::optional<AppConfigSection> appConfigSectionOf(uint8_t type) noexcept {
+        if (type >= 100 && type < 116) {
+            return AppConfigSection::schedule;
+        }
+
+        if (type >= 150 && type < 174) {
+            return AppConfigSection::schedule;
+        }
+
+        switch (type) {
+            case 1:
+            case 2:
+            case 3:
+                return AppConfigSection::hotspot;
+            case 4:
+            case 5:
+            case 6:
+            case 7:
+                return AppConfigSection::storage;
+            case 8:
+            case 9:
+            case 10:
+                return AppConfigSection::rotation;
+            case 11:
+                return AppConfigSection::clock;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    // Sets the system time, in seconds since the Unix epoch.
+    struct TimeRequest {
+        uint64_t timestamp{};
+    };
+
+    using TimeRequestSchema = TlvSchema::Schema<
+        TlvSchema::Field<1, [](auto& message) -> auto& { return message.timestamp; }, TlvSchema::As<uint64_t>>>;
+
+    // Storage, clock and recording telemetry. The histogram has log2 buckets in milliseconds.
+    struct SystemInfo {
+        uint64_t sdFreeBytes{};
+        uint64_t sdUsedBytes{};
+        uint64_t timestamp{};
+        uint32_t bitrate{};
+        uint32_t fallbackCount{};
+        uint64_t lastSegmentBytes{};
+        uint32_t lastSegmentMaxLatencyMs{};
+        uint32_t lastSegmentQueueOverflows{};
+        uint32_t currentSegmentMaxLatencyMs{};
+        uint32_t totalQueueOverflows{};
+        std::array<uint32_t, 10> latencyHistogram{};
+    };
+
+    using SystemInfoSchema = TlvSchema::Schema<
+        TlvSchema::Field<1, [](auto& message) -> auto& { return message.sdFreeBytes; }, TlvSchema::As<uint64_t>>,
+        TlvSchema::Field<2, [](auto& message) -> auto& { return message.sdUsedBytes; }, TlvSchema::As<uint64_t>>,
+        TlvSchema::Field<3, [](auto& message) -> auto& { return message.timestamp; }, TlvSchema::As<uint64_t>>,
+        TlvSchema::Field<4, [](auto& message) -> auto& { return message.bitrate; }, TlvSchema::As<uint32_t>>,
+        TlvSchema::Field<5, [](auto& message) -> auto& { return message.fallbackCount; }, TlvSchema::As<uint32_t>>,
+        TlvSchema::Field<6, [](auto& message) -> auto& { return message.lastSegmentBytes; }, TlvSchema::As<uint64_t>>,
+        TlvSchema::Field<7, [](auto& message) -> auto& { return message.lastSegmentMaxLatencyMs; },
+            TlvSchema::As<uint32_t>>,
+        TlvSchema::Field<8, [](auto& message) -> auto& { return message.lastSegmentQueueOverflows; },
+            TlvSchema::As<uint32_t>>,
+        TlvSchema::Field<9, [](auto& message) -> auto& { return message.currentSegmentMaxLatencyMs; },
+            TlvSchema::As<uint32_t>>,
+        TlvSchema::Field<10, [](auto& message) -> auto& { return message.totalQueueOverflows; },
+            TlvSchema::As<uint32_t>>,
+        TlvSchema::Repeated<20, 1, 10, [](auto& message) -> auto& { return message.latencyHistogram; },
+            TlvSchema::Field<0, [](auto& item) -> auto& { return item; }, TlvSchema::As<uint32_t>>>>;
+} // namespace Protocol
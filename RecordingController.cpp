@@ -1,10 +1,22 @@
 #include "RecordingController.hpp"
 
+#include "IdlePowerManager.hpp"
 #include "MixingStreamer.hpp"
 #include "RecordingStateMachine.hpp"
+#include "Resources.hpp"
+#include "RotationPolicy.hpp"
+#include "StorageManager.hpp"
+#include "StorageUtil.hpp"
+#include "SystemClock.hpp"
 #include "TimeUtil.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <utility>
 
 #include <LOGUARTClass.h>
 #include <PowerMode.h>
@@ -16,50 +28,216 @@
 #include <portmacro.h>
 
 namespace {
-    constexpr int32_t skippingThresholdSec    = 60;
-    constexpr uint32_t delayMsBeforeDeepSleep = 15 * 60 * 1000;
+    constexpr int64_t directoryLookaheadSec = 24 * 60 * 60;
+    constexpr uint32_t recordingTickMs      = 500;
+    constexpr uint32_t transitionPollMs     = 250;
 } // namespace
 
 class RecordingController::impl {
 public:
-    impl(DS3231& rtc, MixingStreamer& streamer) : rtc_{rtc}, initTime_{millis()}, streamer_{streamer} {}
+    impl(DS3231& rtc, MixingStreamer& streamer, StorageManager& storage, IdlePowerManager& power)
+        : rtc_{rtc}, streamer_{streamer}, storage_{storage}, power_{power} {
+        storage_.setActiveSegmentSource([this] { return streamer_.currentSegment(); });
+        streamer_.onSegmentFinalized([this](const String& relativePath) {
+            storage_.addSegment(relativePath);
+            progressDirty_.store(true, std::memory_order_release);
+        });
+    }
+
+    ~impl() {
+        streamer_.onSegmentFinalized({});
+        storage_.setActiveSegmentSource({});
+    }
 
-    void update(const AppConfig::RecordingConfig& config) {
-        stateMachine_.update(config.schedule);
-        streamer_.setBaseFileName(config.baseName);
-        streamer_.setSingleFileDuration(config.singleFileDuration);
+    void restore(const ScheduleProgress& progress) {
+        restoredProgress_.emplace(progress);
     }
 
-    void tick() {
+    // Redoes only the work of the changed sections. The duration policy follows the single file duration, and the
+    // directories follow both the layout and the schedule.
+    void update(const AppConfig::RecordingConfig& config, const AppConfig::Changes& changes) {
+        const auto schedule = changes.contains(ConfigSection::schedule);
+        const auto storage  = changes.contains(ConfigSection::storage);
+
+        if (schedule) {
+            stateMachine_.update(config.schedule, config.rules);
+            progressDirty_.store(true, std::memory_order_release);
+
+            // The snapshot from the previous boot only applies to the schedule it was taken from.
+            if (restoredProgress_) {
+                if (stateMachine_.restoreProgress(*restoredProgress_)) {
+                    progress_      = *restoredProgress_;
+                    resumePending_ = progress_.sessionStart != 0;
+                    Serial.println("Schedule progress restored.");
+                } else {
+                    Serial.println("Schedule changed since the last boot, progress discarded.");
+                }
+
+                restoredProgress_.reset();
+            }
+        }
+
+        if (storage) {
+            streamer_.setBaseFileName(config.baseName);
+            streamer_.setSingleFileDuration(config.singleFileDuration);
+            streamer_.setDirectoryLayout(config.directoryLayout);
+            storage_.setMinFreeSpace(static_cast<uint64_t>(config.minFreeSpaceMb) * 1024 * 1024);
+        }
+
+        if (storage || changes.contains(ConfigSection::rotation)) {
+            applyRotation(config);
+        }
+
+        if (schedule || storage) {
+            prepareDirectories(config);
+        }
+    }
+
+    uint32_t tick() {
         bool recorded{};
-        const auto now = TimeUtil::toUnixTimestamp(rtc_.getDateTime());
+        const auto now = globalSystemClock.now();
 
         if (const auto item = stateMachine_.tryMatch(now, recorded)) {
+            power_.update(std::nullopt, true);
             streamer_.startRecording(now);
+            progress_.sessionStart = now;
+            resumePending_         = false;
+            progressDirty_.store(true, std::memory_order_release);
 
             Serial.print("Start recording: ");
-            Serial.println(TimeUtil::toIso8601(rtc_.getDateTime()));
+            Serial.println(TimeUtil::toIso8601(TimeUtil::toDateTime(now)));
             Serial.print("Duration: ");
             Serial.println(item->duration);
 
+            for (size_t i = 0, count = stateMachine_.sourceCount(now); i < count; i++) {
+                const auto source = stateMachine_.source(now, i);
+
+                Serial.print("  Covers plan at ");
+                Serial.print(TimeUtil::toIso8601(TimeUtil::toDateTime(source->startTimestamp)));
+                Serial.print(" for ");
+                Serial.print(source->duration);
+                Serial.println(" sec");
+            }
+        } else if (recorded && resumePending_) {
+            power_.update(std::nullopt, true);
+            resumePending_ = false;
+            streamer_.resumeRecording(now, progress_.sessionStart, progress_.segmentIndex);
+
+            Serial.print("Resume recording after segment ");
+            Serial.println(progress_.lastSegment.data());
+        } else if (recorded) {
+            streamer_.tick(now);
+        } else {
+            resumePending_ = false;
+
+            if (streamer_.stopRecording(now)) {
+                Serial.print("Stop recording: ");
+                Serial.println(TimeUtil::toIso8601(TimeUtil::toDateTime(now)));
+            }
+
+            if (progress_.sessionStart != 0) {
+                progress_.sessionStart = 0;
+                progressDirty_.store(true, std::memory_order_release);
+            }
+
+            saveProgress();
+
+            if (power_.update(secondsToNextStart(now), false) == PowerTier::deepSleep) {
+                scheduleNextWakeup(now);
+            }
+        }
+
+        saveProgress();
+
+        return toNextTickMs(now, recorded);
+    }
+
+    // Milliseconds until the next window that has not been recorded yet opens, zero once it has.
+    std::optional<uint32_t> msToNextStart() {
+        const auto nowMs = globalSystemClock.nowMs();
+
+        if (const auto next = stateMachine_.nextPending(nowMs / 1000)) {
+            return static_cast<uint32_t>(
+                std::clamp<int64_t>(next->startTimestamp * 1000 - nowMs, 0, std::numeric_limits<uint32_t>::max()));
+        }
+
+        return std::nullopt;
+    }
+
+private:
+    // Runs on the main loop only; the segment callback just marks the progress dirty.
+    void saveProgress() {
+        if (!progressDirty_.exchange(false, std::memory_order_acq_rel)) {
             return;
         }
 
-        if (recorded) {
-            return streamer_.tick(now);
+        const auto segment = streamer_.currentSegment();
+
+        stateMachine_.saveProgress(progress_);
+        progress_.segmentIndex = streamer_.segmentIndex();
+        progress_.lastSegment.fill('\0');
+        std::strncpy(progress_.lastSegment.data(), segment.c_str(), progress_.lastSegment.size() - 1);
+        progress_.saveToFlash();
+    }
+
+    void applyRotation(const AppConfig::RecordingConfig& config) {
+        auto&& rotation = config.rotation;
+
+        streamer_.clearRotationPolicies();
+        streamer_.addRotationPolicy(RotationPolicies::maxDuration(streamer_.singleFileDuration()));
+
+        if (rotation.maxSegmentSizeMb != 0) {
+            streamer_.addRotationPolicy(
+                RotationPolicies::maxBytes(static_cast<uint64_t>(rotation.maxSegmentSizeMb) * 1024 * 1024));
         }
 
-        if (streamer_.stopRecording(now)) {
-            Serial.print("Stop recording: ");
-            Serial.println(TimeUtil::toIso8601(rtc_.getDateTime()));
+        if (rotation.alignmentSec != 0) {
+            streamer_.addRotationPolicy(RotationPolicies::wallClockAligned(rotation.alignmentSec));
         }
 
-        if (millis() - initTime_ > delayMsBeforeDeepSleep) {
-            scheduleNextWakeup(now);
+        streamer_.setKeyframeAligned(rotation.keyframeAligned);
+    }
+
+    void prepareDirectories(const AppConfig::RecordingConfig& config) {
+        if (config.directoryLayout == DirectoryLayout::flat) {
+            return;
+        }
+
+        const auto now  = globalSystemClock.now();
+        const auto step = config.directoryLayout == DirectoryLayout::hourly ? 60 * 60 : 24 * 60 * 60;
+        String lastDirectory;
+
+        const auto prepare = [&](int64_t start, int64_t end) {
+            for (auto timestamp = std::max(start, now); timestamp < end; timestamp = (timestamp / step + 1) * step) {
+                auto directory =
+                    StorageUtil::toSegmentDirectory(config.directoryLayout, TimeUtil::toDateTime(timestamp));
+
+                if (directory != lastDirectory) {
+                    StorageUtil::createDirectories(SDFs, directory);
+                    lastDirectory = std::move(directory);
+                }
+            }
+        };
+
+        // Creates the directories of the upcoming windows up front, so that rotation never pays for `mkdir`.
+        for (auto&& item : config.schedule) {
+            const auto end = item.startTimestamp + item.duration;
+
+            if (end <= now || item.startTimestamp > now + directoryLookaheadSec) {
+                continue;
+            }
+
+            prepare(item.startTimestamp, end);
+        }
+
+        for (auto&& item : config.rules) {
+            for (auto start = item.firstStartEndingAfter(now); start && *start <= now + directoryLookaheadSec;
+                 start      = item.firstStartEndingAfter(*start + item.duration)) {
+                prepare(*start, *start + item.duration);
+            }
         }
     }
 
-private:
     void scheduleNextWakeup(int64_t timestamp) {
         const auto nextPlan = stateMachine_.nextPending(timestamp);
 
@@ -68,18 +246,23 @@ private:
             enterDeepSleep();
         }
 
-        if (const auto secondsToNext = nextPlan->startTimestamp - timestamp; secondsToNext <= skippingThresholdSec) {
+        // Wakes just early enough for the slowest measured alarm boot to be ready when the window opens; faster boots
+        // wait for it before their first tick.
+        const auto leadSec = static_cast<int64_t>(power_.wakeLatencyMs(PowerTier::deepSleep) / 1000 + 1);
+
+        if (const auto secondsToNext = nextPlan->startTimestamp - timestamp;
+            secondsToNext <= std::max(IdlePowerManager::minDeepSleepSec, leadSec)) {
             Serial.print("Next recording in ");
             Serial.print(secondsToNext);
             Serial.println(" sec, skipping sleep.");
+            power_.cancelDeepSleep();
             return;
         }
 
-        const DateTime wakeTime{nextPlan->startTimestamp - skippingThresholdSec};
+        const auto wakeTime = TimeUtil::toDateTime(nextPlan->startTimestamp - leadSec);
 
-        rtc_.clearAlarm1Flag();
-        rtc_.setAlarm1(wakeTime);
-        rtc_.enableAlarm1(true);
+        // The INT/SQW pin carries the 1 Hz square wave while awake and has to signal the alarm during deep sleep.
+        rtc_.armAlarm1(wakeTime);
 
         Serial.print("Next wake scheduled at: ");
         Serial.println(TimeUtil::toIso8601(wakeTime));
@@ -87,6 +270,35 @@ private:
         enterDeepSleep();
     }
 
+    // Only called while idle, when the next transition is the start of the next window.
+    std::optional<int64_t> secondsToNextStart(int64_t timestamp) {
+        if (const auto next = stateMachine_.nextTransition(timestamp)) {
+            return *next - timestamp;
+        }
+
+        return std::nullopt;
+    }
+
+    // Returns how long the caller may block before the next window starts or ends, or the power tier has to change.
+    // While recording, the streamer still needs regular ticks for size-based rotation and latency probing.
+    uint32_t toNextTickMs(int64_t timestamp, bool recorded) {
+        auto result = recorded ? recordingTickMs : std::numeric_limits<uint32_t>::max();
+
+        if (const auto next = stateMachine_.nextTransition(timestamp)) {
+            // The RTC only resolves whole seconds, so the last second before a transition is polled.
+            const auto remainingSec =
+                std::clamp<int64_t>(*next - timestamp, 1, std::numeric_limits<uint32_t>::max() / 1000);
+
+            result = std::min(result, static_cast<uint32_t>(remainingSec - 1) * 1000 + transitionPollMs);
+        }
+
+        if (!recorded) {
+            result = std::min(result, power_.nextDecisionMs(secondsToNextStart(timestamp)));
+        }
+
+        return result;
+    }
+
     [[noreturn]] void enterDeepSleep() {
         Serial.println("Entering deep sleep...");
         vTaskDelay(1000 / portTICK_PERIOD_MS);
@@ -99,22 +311,36 @@ private:
     }
 
     DS3231& rtc_;
-    uint32_t initTime_;
     MixingStreamer& streamer_;
+    StorageManager& storage_;
+    IdlePowerManager& power_;
     RecordingStateMachine stateMachine_;
+    ScheduleProgress progress_;
+    std::optional<ScheduleProgress> restoredProgress_;
+    std::atomic_bool progressDirty_{};
+    bool resumePending_{};
 };
 
-RecordingController::RecordingController(DS3231& rtc, MixingStreamer& streamer)
-    : impl_(std::make_unique<impl>(rtc, streamer)) {}
+RecordingController::RecordingController(
+    DS3231& rtc, MixingStreamer& streamer, StorageManager& storage, IdlePowerManager& power)
+    : impl_(std::make_unique<impl>(rtc, streamer, storage, power)) {}
 
 RecordingController::RecordingController(RecordingController&&) noexcept            = default;
 RecordingController::~RecordingController()                                         = default;
 RecordingController& RecordingController::operator=(RecordingController&&) noexcept = default;
 
-void RecordingController::update(const AppConfig::RecordingConfig& config) const {
-    impl_->update(config);
+void RecordingController::restore(const ScheduleProgress& progress) const {
+    impl_->restore(progress);
+}
+
+void RecordingController::update(const AppConfig::RecordingConfig& config, const AppConfig::Changes& changes) const {
+    impl_->update(config, changes);
+}
+
+uint32_t RecordingController::tick() const {
+    return impl_->tick();
 }
 
-void RecordingController::tick() const {
-    impl_->tick();
+std::optional<uint32_t> RecordingController::msToNextStart() const {
+    return impl_->msToNextStart();
 }
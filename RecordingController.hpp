@@ -2,19 +2,26 @@
 
 #include "AppConfig.hpp"
 #include "DS3231.hpp"
+#include "ScheduleProgress.hpp"
 
+#include <cstdint>
 #include <memory>
+#include <optional>
 
+class IdlePowerManager;
 class MixingStreamer;
+class StorageManager;
 
 class RecordingController {
 public:
-    RecordingController(DS3231& rtc, MixingStreamer& streamer);
+    RecordingController(DS3231& rtc, MixingStreamer& streamer, StorageManager& storage, IdlePowerManager& power);
     RecordingController(RecordingController&&) noexcept;
     ~RecordingController();
     RecordingController& operator=(RecordingController&&) noexcept;
-    void update(const AppConfig::RecordingConfig& config) const;
-    void tick() const;
+    void restore(const ScheduleProgress& progress) const;
+    void update(const AppConfig::RecordingConfig& config, const AppConfig::Changes& changes) const;
+    uint32_t tick() const;
+    std::optional<uint32_t> msToNextStart() const;
 
 private:
     class impl;
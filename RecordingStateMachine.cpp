@@ -1,78 +1,315 @@
 #include "RecordingStateMachine.hpp"
 
-#include "CryptoUtil.hpp"
-
+#include <algorithm>
 #include <limits>
 #include <utility>
 
-void RecordingStateMachine::update(std::span<const AppConfig::RecordingPlan> schedule) {
-    itemMapping_.clear();
+namespace {
+    constexpr size_t initialCapacity = 32;
+    constexpr size_t bitsPerWord     = 32;
+    constexpr int64_t keyEpoch       = 1577836800LL; // 2020-01-01T00:00:00Z
+    constexpr uint32_t keyBias       = 0x80000000U;
+    constexpr int64_t windowSec      = 24 * 60 * 60;
 
-    for (auto&& item : schedule) {
-        const auto key =
-            CryptoUtil::sha256(String{static_cast<uint32_t>(static_cast<uint64_t>(item.startTimestamp) >> 32)}
-                               + String{static_cast<uint32_t>(item.startTimestamp)} + String{item.duration});
+    // The high word holds the biased start time in seconds since 2020 and the low word the duration, so the key is
+    // an exact identity of the plan and orders plans by start time.
+    constexpr uint64_t toStartKey(int64_t timestamp) noexcept {
+        const auto since2020 = std::clamp<int64_t>(timestamp - keyEpoch, std::numeric_limits<int32_t>::min(),
+            std::numeric_limits<int32_t>::max());
 
-        itemMapping_.insert_or_assign(key, item);
+        return static_cast<uint64_t>(static_cast<uint32_t>(since2020) ^ keyBias) << 32;
     }
 
-    for (auto&& [key, value] : stateMapping_) {
-        if (!itemMapping_.contains(key)) {
-            stateMapping_.erase(key);
-        }
+    constexpr uint64_t toKey(const AppConfig::RecordingPlan& plan) noexcept {
+        return toStartKey(plan.startTimestamp) | plan.duration;
+    }
+
+    constexpr int64_t startOf(uint64_t key) noexcept {
+        return static_cast<int32_t>(static_cast<uint32_t>(key >> 32) ^ keyBias) + keyEpoch;
+    }
+
+    constexpr uint32_t durationOf(uint64_t key) noexcept {
+        return static_cast<uint32_t>(key);
     }
 
-    for (auto&& [key, value] : itemMapping_) {
-        if (!stateMapping_.contains(key)) {
-            stateMapping_.insert_or_assign(key, false);
+    constexpr int64_t endOf(uint64_t key) noexcept {
+        return startOf(key) + durationOf(key);
+    }
+
+    constexpr AppConfig::RecordingPlan toPlan(uint64_t key) noexcept {
+        return {
+            .startTimestamp = startOf(key),
+            .duration       = durationOf(key),
+        };
+    }
+
+    constexpr uint32_t fnvOffsetBasis = 2166136261U;
+    constexpr uint32_t fnvPrime       = 16777619U;
+
+    constexpr uint32_t fnv1a(uint32_t hash, uint64_t value) noexcept {
+        for (size_t i = 0; i < sizeof(value); i++) {
+            hash = (hash ^ static_cast<uint8_t>(value >> (i * 8))) * fnvPrime;
         }
+
+        return hash;
+    }
+
+    constexpr size_t wordCount(size_t bits) noexcept {
+        return (bits + bitsPerWord - 1) / bitsPerWord;
+    }
+} // namespace
+
+RecordingStateMachine::RecordingStateMachine() : fingerprint_{fnvOffsetBasis} {
+    planKeys_.reserve(initialCapacity);
+    keys_.reserve(initialCapacity);
+    states_.reserve(wordCount(initialCapacity));
+    sourceKeys_.reserve(initialCapacity);
+    sourceOffsets_.reserve(initialCapacity + 1);
+    pendingKeys_.reserve(initialCapacity);
+    pendingStates_.reserve(wordCount(initialCapacity));
+}
+
+void RecordingStateMachine::update(
+    std::span<const AppConfig::RecordingPlan> schedule, std::span<const AppConfig::RecurringRule> rules) {
+    planKeys_.clear();
+
+    for (auto&& item : schedule) {
+        planKeys_.emplace_back(toKey(item));
+    }
+
+    rules_.assign(rules.begin(), rules.end());
+    windowStart_.reset();
+
+    // Identifies the schedule a progress snapshot was taken from.
+    fingerprint_ = fnvOffsetBasis;
+
+    for (auto&& item : planKeys_) {
+        fingerprint_ = fnv1a(fingerprint_, item);
+    }
+
+    for (auto&& item : rules_) {
+        fingerprint_ = fnv1a(fingerprint_, static_cast<uint64_t>(item.anchorTimestamp));
+        fingerprint_ = fnv1a(fingerprint_, static_cast<uint64_t>(item.duration) << 32
+                                               | static_cast<uint64_t>(item.kind) << 24
+                                               | static_cast<uint64_t>(item.weekdayMask) << 16 | item.intervalHours);
     }
 }
 
+void RecordingStateMachine::saveProgress(ScheduleProgress& progress) const {
+    progress.fingerprint = fingerprint_;
+    progress.windowStart = windowStart_.value_or(0);
+    progress.started.fill(0);
+    std::copy_n(states_.begin(), std::min(states_.size(), progress.started.size()), progress.started.begin());
+}
+
+// Expands the same window as when the snapshot was taken, so the stored bits line up with the windows again.
+bool RecordingStateMachine::restoreProgress(const ScheduleProgress& progress) {
+    if (progress.fingerprint != fingerprint_) {
+        return false;
+    }
+
+    rebuild(progress.windowStart);
+    std::copy_n(progress.started.begin(), std::min(states_.size(), progress.started.size()), states_.begin());
+
+    return true;
+}
+
 std::optional<AppConfig::RecordingPlan> RecordingStateMachine::tryMatch(int64_t timestamp, bool& recorded) {
-    std::optional<AppConfig::RecordingPlan> result;
-    bool found{};
-    recorded = false;
+    ensureWindow(timestamp);
+
+    const auto found = indexOf(timestamp);
+    recorded         = false;
 
-    for (auto&& [key, value] : itemMapping_) {
-        const auto recording = stateMapping_[key];
+    if (active_ && active_ != found) {
+        setStarted(*active_, false);
+    }
 
-        if (!found && timestamp >= value.startTimestamp && timestamp < value.startTimestamp + value.duration) {
-            recorded = true;
+    active_ = found;
 
-            if (!recording) {
-                stateMapping_.insert_or_assign(key, true);
-                result.emplace(value);
-                found = true;
+    if (!found) {
+        return std::nullopt;
+    }
+
+    recorded = true;
+
+    if (started(*found)) {
+        return std::nullopt;
+    }
+
+    setStarted(*found, true);
+
+    return toPlan(keys_[*found]);
+}
+
+std::optional<AppConfig::RecordingPlan> RecordingStateMachine::nextPending(int64_t timestamp) {
+    ensureWindow(timestamp);
+
+    // Rule occurrences past the expanded window cannot have started yet.
+    auto result = ruleAfterWindow_;
+
+    for (auto i = countStartedBefore(timestamp); i < keys_.size(); i++) {
+        if (!started(i)) {
+            if (const auto plan = toPlan(keys_[i]); !result || plan.startTimestamp < result->startTimestamp) {
+                result.emplace(plan);
             }
 
-            continue;
+            break;
         }
+    }
+
+    return result;
+}
+
+// Returns the earliest time after `timestamp` at which `tryMatch` may yield a different result: the end of the active
+// window or the start of the next plan, whichever comes first.
+std::optional<int64_t> RecordingStateMachine::nextTransition(int64_t timestamp) {
+    ensureWindow(timestamp);
+
+    std::optional<int64_t> result;
 
-        if (recording) {
-            stateMapping_.insert_or_assign(key, false);
+    if (ruleAfterWindow_) {
+        result.emplace(ruleAfterWindow_->startTimestamp);
+    }
+
+    if (active_ && contains(*active_, timestamp) && (!result || endOf(keys_[*active_]) < *result)) {
+        result.emplace(endOf(keys_[*active_]));
+    }
+
+    if (const auto next = countStartedBefore(timestamp); next < keys_.size()) {
+        if (const auto start = startOf(keys_[next]); !result || start < *result) {
+            result.emplace(start);
         }
     }
 
     return result;
 }
 
-std::optional<AppConfig::RecordingPlan> RecordingStateMachine::nextPending(int64_t timestamp) {
-    auto nearestStart = std::numeric_limits<int64_t>::max();
-    std::optional<std::reference_wrapper<AppConfig::RecordingPlan>> nearest;
+void RecordingStateMachine::ensureWindow(int64_t timestamp) {
+    if (!windowStart_ || timestamp < *windowStart_ || timestamp >= *windowStart_ + windowSec / 2) {
+        rebuild(timestamp);
+    }
+}
+
+void RecordingStateMachine::rebuild(int64_t timestamp) {
+    const auto windowEnd = timestamp + windowSec;
+
+    pendingKeys_.assign(planKeys_.begin(), planKeys_.end());
+
+    for (auto&& item : rules_) {
+        for (auto start = item.firstStartEndingAfter(timestamp); start && *start < windowEnd;
+             start      = item.firstStartEndingAfter(*start + item.duration)) {
+            pendingKeys_.emplace_back(toKey({.startTimestamp = *start, .duration = item.duration}));
+        }
+    }
+
+    std::ranges::sort(pendingKeys_);
+    pendingKeys_.erase(std::ranges::unique(pendingKeys_).begin(), pendingKeys_.end());
+    std::swap(sourceKeys_, pendingKeys_);
+
+    // Merges overlapping and adjacent plans, so that continuous coverage is a single window and never restarts.
+    pendingKeys_.clear();
+    sourceOffsets_.clear();
+
+    for (size_t i = 0; i < sourceKeys_.size();) {
+        const auto start = startOf(sourceKeys_[i]);
+        auto end         = endOf(sourceKeys_[i]);
+
+        sourceOffsets_.emplace_back(static_cast<uint32_t>(i));
+
+        for (i++; i < sourceKeys_.size() && startOf(sourceKeys_[i]) <= end; i++) {
+            end = std::max(end, endOf(sourceKeys_[i]));
+        }
+
+        const auto duration = std::min<int64_t>(end - start, std::numeric_limits<uint32_t>::max());
+
+        pendingKeys_.emplace_back(toKey({.startTimestamp = start, .duration = static_cast<uint32_t>(duration)}));
+    }
+
+    sourceOffsets_.emplace_back(static_cast<uint32_t>(sourceKeys_.size()));
+    pendingStates_.assign(wordCount(pendingKeys_.size()), 0);
+
+    // A window inherits the state of every previous window it overlaps, so extending or joining the window being
+    // recorded does not start it again.
+    std::optional<size_t> active;
+
+    for (size_t i = 0; i < pendingKeys_.size(); i++) {
+        const auto start = startOf(pendingKeys_[i]);
+        auto j           = countStartedBefore(endOf(pendingKeys_[i]) - 1);
+
+        for (; j > 0 && endOf(keys_[j - 1]) > start; j--) {
+            if (started(j - 1)) {
+                pendingStates_[i / bitsPerWord] |= 1U << (i % bitsPerWord);
+            }
+
+            if (active_ == j - 1) {
+                active.emplace(i);
+            }
+        }
+    }
 
-    for (auto&& [key, value] : itemMapping_) {
-        const auto recording = stateMapping_[key];
+    std::swap(keys_, pendingKeys_);
+    std::swap(states_, pendingStates_);
+    active_ = active;
+    windowStart_.emplace(timestamp);
+    ruleAfterWindow_ = firstRuleOccurrenceFrom(windowEnd);
+}
 
-        if (!recording && value.startTimestamp > timestamp && value.startTimestamp < nearestStart) {
-            nearestStart = value.startTimestamp;
-            nearest.emplace(value);
+// Returns the earliest occurrence of any rule starting at or after `timestamp`.
+std::optional<AppConfig::RecordingPlan> RecordingStateMachine::firstRuleOccurrenceFrom(int64_t timestamp) const {
+    std::optional<AppConfig::RecordingPlan> result;
+
+    for (auto&& item : rules_) {
+        if (const auto start = item.firstStartEndingAfter(timestamp + item.duration - 1);
+            start && (!result || *start < result->startTimestamp)) {
+            result.emplace(AppConfig::RecordingPlan{.startTimestamp = *start, .duration = item.duration});
         }
     }
 
-    if (nearest) {
-        return *nearest;
+    return result;
+}
+
+size_t RecordingStateMachine::sourceCount(int64_t timestamp) const {
+    const auto index = indexOf(timestamp);
+
+    return index ? sourceOffsets_[*index + 1] - sourceOffsets_[*index] : 0;
+}
+
+// Returns one of the configured plans that were merged into the window containing `timestamp`.
+std::optional<AppConfig::RecordingPlan> RecordingStateMachine::source(int64_t timestamp, size_t index) const {
+    if (const auto window = indexOf(timestamp); window && index < sourceCount(timestamp)) {
+        return toPlan(sourceKeys_[sourceOffsets_[*window] + index]);
     }
 
     return std::nullopt;
 }
+
+std::optional<size_t> RecordingStateMachine::indexOf(int64_t timestamp) const noexcept {
+    if (const auto count = countStartedBefore(timestamp); count > 0 && contains(count - 1, timestamp)) {
+        return count - 1;
+    }
+
+    return std::nullopt;
+}
+
+size_t RecordingStateMachine::countStartedBefore(int64_t timestamp) const noexcept {
+    return static_cast<size_t>(
+        std::ranges::upper_bound(keys_, toStartKey(timestamp) | std::numeric_limits<uint32_t>::max()) - keys_.begin());
+}
+
+bool RecordingStateMachine::contains(size_t index, int64_t timestamp) const noexcept {
+    const auto key = keys_[index];
+
+    return timestamp >= startOf(key) && timestamp < endOf(key);
+}
+
+bool RecordingStateMachine::started(size_t index) const noexcept {
+    return (states_[index / bitsPerWord] >> (index % bitsPerWord)) & 1U;
+}
+
+void RecordingStateMachine::setStarted(size_t index, bool value) noexcept {
+    if (value) {
+        states_[index / bitsPerWord] |= 1U << (index % bitsPerWord);
+    } else {
+        states_[index / bitsPerWord] &= ~(1U << (index % bitsPerWord));
+    }
+}
@@ -1,22 +1,52 @@
 #pragma once
 
 #include "AppConfig.hpp"
-#include "HashUtil.hpp"
+#include "ScheduleProgress.hpp"
 
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <span>
-#include <unordered_map>
-
-#include <WString.h>
+#include <vector>
 
 class RecordingStateMachine {
 public:
-    void update(std::span<const AppConfig::RecordingPlan> schedule);
+    RecordingStateMachine();
+    void update(std::span<const AppConfig::RecordingPlan> schedule, std::span<const AppConfig::RecurringRule> rules);
     std::optional<AppConfig::RecordingPlan> tryMatch(int64_t timestamp, bool& recorded);
     std::optional<AppConfig::RecordingPlan> nextPending(int64_t timestamp);
+    std::optional<int64_t> nextTransition(int64_t timestamp);
+    void saveProgress(ScheduleProgress& progress) const;
+    bool restoreProgress(const ScheduleProgress& progress);
+    size_t sourceCount(int64_t timestamp) const;
+    std::optional<AppConfig::RecordingPlan> source(int64_t timestamp, size_t index) const;
 
 private:
-    std::unordered_map<String, AppConfig::RecordingPlan, HashUtil::StringHash> itemMapping_;
-    std::unordered_map<String, bool, HashUtil::StringHash> stateMapping_;
+    void ensureWindow(int64_t timestamp);
+    void rebuild(int64_t timestamp);
+    std::optional<AppConfig::RecordingPlan> firstRuleOccurrenceFrom(int64_t timestamp) const;
+    size_t countStartedBefore(int64_t timestamp) const noexcept;
+    bool contains(size_t index, int64_t timestamp) const noexcept;
+    bool started(size_t index) const noexcept;
+    void setStarted(size_t index, bool value) noexcept;
+
+    std::optional<size_t> indexOf(int64_t timestamp) const noexcept;
+
+    // Recurring rules are expanded into a bounded window ahead of the current time, which is moved forward lazily. The
+    // first occurrence past the window only changes with it, so it is found once per rebuild.
+    std::vector<uint64_t> planKeys_;
+    std::vector<AppConfig::RecurringRule> rules_;
+    std::optional<int64_t> windowStart_;
+    std::optional<AppConfig::RecordingPlan> ruleAfterWindow_;
+    uint32_t fingerprint_;
+
+    // Plans are normalized into disjoint intervals, kept as identity keys sorted by start time with a parallel
+    // "started" bitset. The plans merged into interval `i` are `sourceKeys_[sourceOffsets_[i]..sourceOffsets_[i + 1])`.
+    std::vector<uint64_t> keys_;
+    std::vector<uint32_t> states_;
+    std::vector<uint64_t> sourceKeys_;
+    std::vector<uint32_t> sourceOffsets_;
+    std::vector<uint64_t> pendingKeys_;
+    std::vector<uint32_t> pendingStates_;
+    std::optional<size_t> active_;
 };
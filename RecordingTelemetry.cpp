@@ -0,0 +1,78 @@
+#include "RecordingTelemetry.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#if 1
+#include <FreeRTOS.h>
+#endif
+
+#include <semphr.h>
+
+namespace {
+    void addLatency(RecordingTelemetry::SegmentStats& stats, uint32_t latencyMs) noexcept {
+        const auto bucket = std::min<size_t>(std::bit_width(latencyMs), RecordingTelemetry::bucketCount - 1);
+
+        ++stats.latencyHistogram[bucket];
+        stats.maxLatencyMs = std::max(stats.maxLatencyMs, latencyMs);
+    }
+} // namespace
+
+RecordingTelemetry::RecordingTelemetry() : mutex_{xSemaphoreCreateMutex()} {}
+
+RecordingTelemetry::~RecordingTelemetry() {
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+        mutex_ = nullptr;
+    }
+}
+
+void RecordingTelemetry::recordLatency(uint32_t latencyMs) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    addLatency(data_.current, latencyMs);
+    addLatency(data_.total, latencyMs);
+    xSemaphoreGive(mutex_);
+}
+
+void RecordingTelemetry::recordOverflows(uint32_t count) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    data_.current.queueOverflows += count;
+    data_.total.queueOverflows += count;
+    xSemaphoreGive(mutex_);
+}
+
+void RecordingTelemetry::beginSegment() {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    data_.current = {};
+    xSemaphoreGive(mutex_);
+}
+
+void RecordingTelemetry::endSegment(uint64_t bytesWritten) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    data_.current.bytesWritten = bytesWritten;
+    data_.total.bytesWritten += bytesWritten;
+    data_.last    = data_.current;
+    data_.current = {};
+    xSemaphoreGive(mutex_);
+}
+
+void RecordingTelemetry::setBitrate(uint32_t bitrate, bool fallback) {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    data_.bitrate = bitrate;
+
+    if (fallback) {
+        ++data_.fallbackCount;
+    }
+
+    xSemaphoreGive(mutex_);
+}
+
+RecordingTelemetry::Snapshot RecordingTelemetry::snapshot() const {
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    const auto result = data_;
+    xSemaphoreGive(mutex_);
+
+    return result;
+}
+
+RecordingTelemetry globalRecordingTelemetry;
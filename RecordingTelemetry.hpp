@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+struct QueueDefinition;
+
+class RecordingTelemetry {
+public:
+    // Log2 buckets in milliseconds: [0, 1), [1, 2), [2, 4) ... [256, inf).
+    static constexpr size_t bucketCount = 10;
+
+    struct SegmentStats {
+        std::array<uint32_t, bucketCount> latencyHistogram{};
+        uint32_t maxLatencyMs{};
+        uint64_t bytesWritten{};
+        uint32_t queueOverflows{};
+    };
+
+    struct Snapshot {
+        SegmentStats current;
+        SegmentStats last;
+        SegmentStats total;
+        uint32_t bitrate{};
+        uint32_t fallbackCount{};
+    };
+
+    RecordingTelemetry();
+    RecordingTelemetry(const RecordingTelemetry&) = delete;
+    ~RecordingTelemetry();
+    RecordingTelemetry& operator=(const RecordingTelemetry&) = delete;
+    void recordLatency(uint32_t latencyMs);
+    void recordOverflows(uint32_t count);
+    void beginSegment();
+    void endSegment(uint64_t bytesWritten);
+    void setBitrate(uint32_t bitrate, bool fallback = false);
+    Snapshot snapshot() const;
+
+private:
+    QueueDefinition* mutex_;
+    Snapshot data_;
+};
+
+extern RecordingTelemetry globalRecordingTelemetry;
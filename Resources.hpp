@@ -5,7 +5,7 @@
 #include <cstdint>
 
 class AmebaFatFS;
-struct QueueDefinition;
+struct tskTaskControlBlock;
 
 extern const char mainHtml[];
 extern const char stylesCss[];
@@ -17,8 +17,11 @@ extern const char jMuxerScript[];
 extern const char appConfigFileName[];
 
 extern AmebaFatFS& SDFs;
-extern QueueDefinition* globalAppMutex;
-extern std::atomic_int32_t globalNowSince2020;
+extern tskTaskControlBlock* globalMainTask;
 extern std::atomic_int32_t globalPendingTimestampSince2020;
 
-inline static constexpr size_t flashMemoryMappedSize = 0x1000;
+inline static constexpr size_t flashMemoryMappedSize      = 0x1000;
+inline static constexpr size_t scheduleProgressFlashOffset = flashMemoryMappedSize;
+inline static constexpr size_t bootProfileFlashOffset      = scheduleProgressFlashOffset + flashMemoryMappedSize;
+inline static constexpr size_t configStoreFlashOffset      = bootProfileFlashOffset + flashMemoryMappedSize;
+inline static constexpr size_t configStoreSectorCount      = 4;
@@ -0,0 +1,54 @@
+#include "RotationPolicy.hpp"
+
+namespace RotationPolicies {
+    namespace {
+        class MaxDurationPolicy : public RotationPolicy {
+        public:
+            explicit MaxDurationPolicy(uint32_t seconds) : seconds_{seconds} {}
+
+            bool shouldRotate(const SegmentProgress& progress) const override {
+                return progress.timestamp - progress.startTimestamp >= seconds_;
+            }
+
+        private:
+            uint32_t seconds_;
+        };
+
+        class MaxBytesPolicy : public RotationPolicy {
+        public:
+            explicit MaxBytesPolicy(uint64_t bytes) : bytes_{bytes} {}
+
+            bool shouldRotate(const SegmentProgress& progress) const override {
+                return progress.bytes >= bytes_;
+            }
+
+        private:
+            uint64_t bytes_;
+        };
+
+        // Rotates whenever a period boundary (e.g. the full hour for 3600) is crossed, counted from the epoch.
+        class WallClockAlignedPolicy : public RotationPolicy {
+        public:
+            explicit WallClockAlignedPolicy(uint32_t periodSec) : periodSec_{periodSec} {}
+
+            bool shouldRotate(const SegmentProgress& progress) const override {
+                return progress.timestamp / periodSec_ != progress.startTimestamp / periodSec_;
+            }
+
+        private:
+            uint32_t periodSec_;
+        };
+    } // namespace
+
+    std::unique_ptr<RotationPolicy> maxDuration(uint32_t seconds) {
+        return std::make_unique<MaxDurationPolicy>(seconds);
+    }
+
+    std::unique_ptr<RotationPolicy> maxBytes(uint64_t bytes) {
+        return std::make_unique<MaxBytesPolicy>(bytes);
+    }
+
+    std::unique_ptr<RotationPolicy> wallClockAligned(uint32_t periodSec) {
+        return std::make_unique<WallClockAlignedPolicy>(periodSec);
+    }
+} // namespace RotationPolicies
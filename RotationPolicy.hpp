@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+struct SegmentProgress {
+    int64_t startTimestamp{};
+    int64_t timestamp{};
+    uint64_t bytes{};
+};
+
+struct RotationPolicy {
+    virtual ~RotationPolicy()                                        = default;
+    virtual bool shouldRotate(const SegmentProgress& progress) const = 0;
+};
+
+namespace RotationPolicies {
+    std::unique_ptr<RotationPolicy> maxDuration(uint32_t seconds);
+    std::unique_ptr<RotationPolicy> maxBytes(uint64_t bytes);
+    std::unique_ptr<RotationPolicy> wallClockAligned(uint32_t periodSec);
+} // namespace RotationPolicies
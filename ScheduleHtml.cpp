@@ -60,6 +60,9 @@ constexpr char scheduleHtml[] = R"AAAAA(<!DOCTYPE html>
     </div>
 
     <script>
+        // Plans and rules together fit one schedule response, see `AppConfig::maxScheduleEntries`.
+        const maxScheduleEntries = 6;
+
         let recordingSchedule = [];
 
         function getDurationInHours(time1, time2) {
@@ -156,6 +159,11 @@ constexpr char scheduleHtml[] = R"AAAAA(<!DOCTYPE html>
                 return;
             }
 
+            if (recordingSchedule.length >= maxScheduleEntries) {
+                alert(`The device keeps at most ${maxScheduleEntries} recording plans and rules.`);
+                return;
+            }
+
             // Checks for conflicts with existing schedules
             let conflictFound = false;
 
@@ -0,0 +1,126 @@
+#include "ScheduleProgress.hpp"
+
+#include "HashUtil.hpp"
+#include "Resources.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <type_traits>
+
+#include <FlashMemory.h>
+#include <LOGUARTClass.h>
+
+namespace {
+    constexpr uint32_t progressMagic   = 0x50524F47; // "PROG"
+    constexpr uint32_t progressVersion = 2;
+    constexpr size_t wordSize          = 4;
+    constexpr uint8_t erasedByte       = 0xFF;
+
+    // Saves append one record to the sector instead of rewriting it, and the newest record with a valid CRC is the
+    // current progress. A save cut short by power loss fails its CRC and leaves the record before it in place.
+    struct StoredProgress {
+        uint32_t magic;
+        uint32_t version;
+        ScheduleProgress progress;
+        uint32_t crc;
+    };
+
+    constexpr size_t slotSize  = (sizeof(StoredProgress) + wordSize - 1) / wordSize * wordSize;
+    constexpr size_t slotCount = flashMemoryMappedSize / slotSize;
+
+    static_assert(std::is_trivially_copyable_v<StoredProgress>);
+    static_assert(sizeof(unsigned int) == wordSize);
+    static_assert(slotCount >= 2);
+
+    struct ScanResult {
+        std::optional<ScheduleProgress> latest;
+        size_t freeSlot;
+    };
+
+    uint32_t checksum(const StoredProgress& stored) noexcept {
+        return HashUtil::crc32({reinterpret_cast<const uint8_t*>(&stored), offsetof(StoredProgress, crc)});
+    }
+
+    // Records are appended in slot order, so the first erased slot ends the log.
+    ScanResult scan() {
+        ScanResult result{std::nullopt, slotCount};
+
+        FlashMemory.read(scheduleProgressFlashOffset);
+
+        for (size_t slot = 0; slot < slotCount; slot++) {
+            const std::span<const uint8_t> bytes{FlashMemory.buf + slot * slotSize, slotSize};
+
+            if (std::all_of(bytes.begin(), bytes.end(), [](uint8_t byte) { return byte == erasedByte; })) {
+                result.freeSlot = slot;
+                break;
+            }
+
+            StoredProgress stored;
+
+            std::memcpy(&stored, bytes.data(), sizeof(stored));
+
+            if (stored.magic == progressMagic && stored.version == progressVersion && stored.crc == checksum(stored)) {
+                result.latest.emplace(stored.progress);
+            }
+        }
+
+        return result;
+    }
+} // namespace
+
+// Programs the next free slot, which needs no erase. Only when the sector is full is it erased and restarted with
+// this record, once every `slotCount` saves. Saves that would not change the stored progress write nothing.
+void ScheduleProgress::saveToFlash() const {
+    const auto [latest, freeSlot] = scan();
+
+    if (latest == *this) {
+        return;
+    }
+
+    StoredProgress stored{
+        .magic    = progressMagic,
+        .version  = progressVersion,
+        .progress = *this,
+        .crc      = {},
+    };
+
+    stored.crc = checksum(stored);
+
+    std::array<uint8_t, slotSize> record;
+
+    record.fill(erasedByte);
+    std::memcpy(record.data(), &stored, sizeof(stored));
+
+    if (freeSlot < slotCount) {
+        const auto offset = scheduleProgressFlashOffset + freeSlot * slotSize;
+
+        for (size_t i = 0; i < slotSize; i += wordSize) {
+            unsigned int word;
+
+            std::memcpy(&word, record.data() + i, wordSize);
+            FlashMemory.writeWord(offset + i, word);
+        }
+    } else {
+        std::fill(FlashMemory.buf, FlashMemory.buf + flashMemoryMappedSize, erasedByte);
+        std::copy(record.begin(), record.end(), FlashMemory.buf);
+        FlashMemory.write(scheduleProgressFlashOffset);
+    }
+}
+
+ScheduleProgress ScheduleProgress::fromFlash() {
+    auto latest = scan().latest;
+
+    if (!latest) {
+        Serial.println("No schedule progress found in flash.");
+        return {};
+    }
+
+    latest->lastSegment.back() = '\0';
+    Serial.println("Schedule progress loaded from flash.");
+
+    return *latest;
+}
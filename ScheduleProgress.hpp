@@ -0,0 +1,25 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// A compact snapshot of how far the schedule has progressed, appended to its own flash sector so that a reboot in
+// the middle of a window continues the interrupted recording session instead of starting a new one.
+struct ScheduleProgress {
+    static constexpr size_t maxWindowCount = 256;
+    static constexpr size_t maxNameLength  = 95;
+
+    uint32_t fingerprint{};
+    int64_t windowStart{};
+    std::array<uint32_t, maxWindowCount / 32> started{};
+    int64_t sessionStart{};
+    uint32_t segmentIndex{};
+    std::array<char, maxNameLength + 1> lastSegment{};
+
+    bool operator==(const ScheduleProgress&) const = default;
+
+    void saveToFlash() const;
+
+    static ScheduleProgress fromFlash();
+};
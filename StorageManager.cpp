@@ -0,0 +1,243 @@
+#include "StorageManager.hpp"
+
+#include "MessageQueue.hpp"
+#include "StorageUtil.hpp"
+#include "TimeUtil.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <iterator>
+#include <utility>
+
+#include <AmebaFatFS.h>
+#include <LOGUARTClass.h>
+#include <ff.h>
+
+namespace {
+    constexpr size_t queueCapacity    = 16;
+    constexpr size_t maxScanDepth     = 2;
+    constexpr char segmentExtension[] = ".mp4";
+
+    struct Segment {
+        int64_t startTimestamp{};
+        uint32_t index{};
+        String path;
+    };
+
+    bool operator<(const Segment& left, const Segment& right) noexcept {
+        return left.startTimestamp != right.startTimestamp ? left.startTimestamp < right.startTimestamp
+                                                           : left.index < right.index;
+    }
+
+    // Recovers the session start and segment index from `<base>_YYYY-MM-DDTHH-MM-SS_<index>.mp4`.
+    bool parseSegmentPath(const String& path, Segment& segment) {
+        const auto indexSeparator = path.lastIndexOf('_');
+
+        if (indexSeparator < 20 || !path.endsWith(segmentExtension)) {
+            return false;
+        }
+
+        uint32_t year{};
+        uint32_t month{};
+        uint32_t day{};
+        uint32_t hour{};
+        uint32_t minute{};
+        uint32_t second{};
+        uint32_t index{};
+
+        if (std::sscanf(path.c_str() + indexSeparator - 19, "%4u-%2u-%2uT%2u-%2u-%2u_%u", &year, &month, &day, &hour,
+                &minute, &second, &index)
+            != 7) {
+            return false;
+        }
+
+        segment.startTimestamp = TimeUtil::toUnixTimestamp(year, month, day, hour, minute, second);
+        segment.index          = index;
+        segment.path           = path;
+
+        return true;
+    }
+
+    String parentDirectory(const String& path) {
+        const auto separator = path.lastIndexOf('/');
+
+        return separator > 0 ? path.substring(0, separator) : String{};
+    }
+} // namespace
+
+class StorageManager::impl {
+public:
+    explicit impl(AmebaFatFS& fs) : fs_{fs}, minFreeSpace_{}, segmentCount_{}, queue_{queueCapacity} {}
+
+    // Only read by the worker, so it has to be set before `begin`.
+    void setActiveSegmentSource(ActiveSegmentSource source) {
+        activeSegment_ = std::move(source);
+    }
+
+    void begin() {
+        queue_.beginInvoke([this] {
+            scanDirectory(String{}, 0);
+            std::sort(segments_.begin(), segments_.end());
+            segmentCount_.store(segments_.size(), std::memory_order_release);
+
+            Serial.print("Storage index built, segments: ");
+            Serial.println(segments_.size());
+
+            evictIfNeeded();
+        });
+    }
+
+    uint64_t minFreeSpace() const {
+        return minFreeSpace_.load(std::memory_order_acquire);
+    }
+
+    void setMinFreeSpace(uint64_t value) {
+        minFreeSpace_.store(value, std::memory_order_release);
+        requestEviction();
+    }
+
+    void addSegment(const String& relativePath) {
+        queue_.beginInvoke([this, relativePath] {
+            Segment segment;
+
+            if (!parseSegmentPath(relativePath, segment)) {
+                return;
+            }
+
+            // Segments normally arrive in order, so this lands at the back; a clock change may place it earlier. The
+            // boot scan may already have indexed a segment that was finalized while it ran.
+            const auto position = std::upper_bound(segments_.begin(), segments_.end(), segment);
+
+            if (position != segments_.begin() && std::prev(position)->path == segment.path) {
+                return;
+            }
+
+            segments_.insert(position, std::move(segment));
+            segmentCount_.store(segments_.size(), std::memory_order_release);
+
+            evictIfNeeded();
+        });
+    }
+
+    void requestEviction() {
+        queue_.beginInvoke([this] { evictIfNeeded(); });
+    }
+
+    size_t segmentCount() const {
+        return segmentCount_.load(std::memory_order_acquire);
+    }
+
+private:
+    // Streams the entries instead of listing them with `readDir`, whose fixed buffer cuts a large flat directory
+    // short and leaves its oldest segments out of the index. The segment being recorded is skipped; it is added once
+    // finalized, and must not be evicted while it is written.
+    void scanDirectory(const String& relativePath, size_t depth) {
+        const auto path = StorageUtil::toAbsolutePath(fs_, relativePath);
+        DIR directory{};
+        FILINFO info{};
+
+        if (f_opendir(&directory, path.c_str()) != FR_OK) {
+            Serial.print("Failed to open directory: ");
+            Serial.println(path);
+            return;
+        }
+
+        auto result = FR_OK;
+
+        while ((result = f_readdir(&directory, &info)) == FR_OK && info.fname[0] != '\0') {
+            const auto childPath = relativePath.length() != 0 ? relativePath + "/" + info.fname : String{info.fname};
+
+            if ((info.fattrib & AM_DIR) != 0) {
+                if (depth < maxScanDepth) {
+                    scanDirectory(childPath, depth + 1);
+                }
+            } else if (Segment segment; parseSegmentPath(childPath, segment)
+                                        && !(activeSegment_ && activeSegment_() == childPath)) {
+                segments_.emplace_back(std::move(segment));
+            }
+        }
+
+        f_closedir(&directory);
+
+        if (result != FR_OK) {
+            Serial.print("Directory scan stopped early, the index misses segments of: ");
+            Serial.println(path);
+        }
+    }
+
+    void evictIfNeeded() {
+        const auto minFreeSpace = minFreeSpace_.load(std::memory_order_acquire);
+
+        if (minFreeSpace == 0) {
+            return;
+        }
+
+        while (!segments_.empty() && static_cast<uint64_t>(fs_.get_free_space()) < minFreeSpace) {
+            auto segment = std::move(segments_.front());
+
+            segments_.pop_front();
+            segmentCount_.store(segments_.size(), std::memory_order_release);
+
+            if (!fs_.remove(StorageUtil::toAbsolutePath(fs_, segment.path).c_str())) {
+                Serial.print("Failed to evict segment: ");
+                Serial.println(segment.path);
+                continue;
+            }
+
+            Serial.print("Evicted segment: ");
+            Serial.println(segment.path);
+
+            // Drops the shard once its last segment is gone; `rmdir` refuses non-empty directories anyway.
+            if (const auto directory = parentDirectory(segment.path);
+                directory.length() != 0
+                && (segments_.empty() || parentDirectory(segments_.front().path) != directory)) {
+                fs_.rmdir(StorageUtil::toAbsolutePath(fs_, directory).c_str());
+            }
+        }
+    }
+
+    AmebaFatFS& fs_;
+    std::atomic_uint64_t minFreeSpace_;
+    std::atomic_size_t segmentCount_;
+    std::deque<Segment> segments_;
+    ActiveSegmentSource activeSegment_;
+    MessageQueue queue_;
+};
+
+StorageManager::StorageManager(AmebaFatFS& fs) : impl_{std::make_unique<impl>(fs)} {}
+
+StorageManager::StorageManager(StorageManager&&) noexcept = default;
+
+StorageManager::~StorageManager() = default;
+
+StorageManager& StorageManager::operator=(StorageManager&&) noexcept = default;
+
+void StorageManager::setActiveSegmentSource(ActiveSegmentSource source) const {
+    impl_->setActiveSegmentSource(std::move(source));
+}
+
+void StorageManager::begin() const {
+    impl_->begin();
+}
+
+uint64_t StorageManager::minFreeSpace() const {
+    return impl_->minFreeSpace();
+}
+
+void StorageManager::setMinFreeSpace(uint64_t value) const {
+    impl_->setMinFreeSpace(value);
+}
+
+void StorageManager::addSegment(const String& relativePath) const {
+    impl_->addSegment(relativePath);
+}
+
+void StorageManager::requestEviction() const {
+    impl_->requestEviction();
+}
+
+size_t StorageManager::segmentCount() const {
+    return impl_->segmentCount();
+}
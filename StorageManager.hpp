@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include <WString.h>
+
+class AmebaFatFS;
+
+class StorageManager {
+public:
+    using ActiveSegmentSource = std::function<String()>;
+
+    explicit StorageManager(AmebaFatFS& fs);
+    StorageManager(StorageManager&&) noexcept;
+    ~StorageManager();
+    StorageManager& operator=(StorageManager&&) noexcept;
+    void setActiveSegmentSource(ActiveSegmentSource source) const;
+    void begin() const;
+    uint64_t minFreeSpace() const;
+    void setMinFreeSpace(uint64_t value) const;
+    void addSegment(const String& relativePath) const;
+    void requestEviction() const;
+    size_t segmentCount() const;
+
+private:
+    class impl;
+
+    std::unique_ptr<impl> impl_;
+};
@@ -0,0 +1,65 @@
+#include "StorageUtil.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include <AmebaFatFS.h>
+#include <LOGUARTClass.h>
+
+namespace StorageUtil {
+    String toSegmentDirectory(DirectoryLayout layout, const DateTime& dateTime) {
+        char buffer[16]{};
+
+        switch (layout) {
+        case DirectoryLayout::daily:
+            std::snprintf(buffer, sizeof(buffer), "%04u-%02u-%02u", dateTime.year, dateTime.month, dateTime.day);
+            break;
+        case DirectoryLayout::hourly:
+            std::snprintf(buffer, sizeof(buffer), "%04u-%02u-%02u/%02u", dateTime.year, dateTime.month, dateTime.day,
+                dateTime.hour);
+            break;
+        default:
+            break;
+        }
+
+        return String{buffer};
+    }
+
+    String toAbsolutePath(AmebaFatFS& fs, const String& relativePath) {
+        return String{fs.getRootPath()} + relativePath;
+    }
+
+    bool createDirectories(AmebaFatFS& fs, const String& relativePath) {
+        static char path[128];
+
+        if (relativePath.length() == 0) {
+            return true;
+        }
+
+        const auto rootLength = std::snprintf(path, sizeof(path), "%s", fs.getRootPath());
+
+        std::snprintf(path + rootLength, sizeof(path) - rootLength, "%s", relativePath.c_str());
+
+        // FatFs creates a single level per call, so every parent is created in turn.
+        for (auto ptr = path + rootLength;; ++ptr) {
+            if (const auto ending = *ptr; ending == '/' || ending == '\0') {
+                *ptr = '\0';
+
+                if (!fs.exists(path) && !fs.mkdir(path)) {
+                    Serial.print("Failed to create directory: ");
+                    Serial.println(path);
+
+                    return false;
+                }
+
+                if (ending == '\0') {
+                    break;
+                }
+
+                *ptr = ending;
+            }
+        }
+
+        return true;
+    }
+} // namespace StorageUtil
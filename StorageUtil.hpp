@@ -0,0 +1,14 @@
+#pragma once
+
+#include "CommonTypes.hpp"
+#include "DateTime.hpp"
+
+#include <WString.h>
+
+class AmebaFatFS;
+
+namespace StorageUtil {
+    String toSegmentDirectory(DirectoryLayout layout, const DateTime& dateTime);
+    String toAbsolutePath(AmebaFatFS& fs, const String& relativePath);
+    bool createDirectories(AmebaFatFS& fs, const String& relativePath);
+} // namespace StorageUtil
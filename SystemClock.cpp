@@ -0,0 +1,102 @@
+#include "SystemClock.hpp"
+
+#include "DS3231.hpp"
+#include "TimeUtil.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+#include <Arduino.h>
+
+namespace {
+    constexpr uint32_t defaultResyncIntervalMs = 10 * 60 * 1000;
+} // namespace
+
+SystemClock::SystemClock()
+    : rtc_{}, resyncIntervalMs_{defaultResyncIntervalMs}, lastResyncMs_{}, sequence_{}, baseSeconds_{}, baseMs_{} {}
+
+void SystemClock::begin(DS3231& rtc) {
+    rtc_ = &rtc;
+    store(static_cast<uint32_t>(TimeUtil::toUnixTimestamp(rtc.getDateTime())), millis());
+    lastResyncMs_ = millis();
+}
+
+uint32_t SystemClock::resyncInterval() const noexcept {
+    return resyncIntervalMs_ / 1000;
+}
+
+void SystemClock::setResyncInterval(uint32_t seconds) noexcept {
+    resyncIntervalMs_ = static_cast<uint32_t>(std::min<uint64_t>(seconds * 1000ULL, UINT32_MAX));
+}
+
+void SystemClock::update() {
+    if (rtc_ && millis() - lastResyncMs_ >= resyncIntervalMs_) {
+        resync();
+    }
+}
+
+void SystemClock::set(int64_t timestamp) {
+    if (rtc_) {
+        rtc_->setDateTime(TimeUtil::toDateTime(timestamp));
+    }
+
+    store(static_cast<uint32_t>(timestamp), millis());
+    lastResyncMs_ = millis();
+}
+
+// Called with the `millis()` value of a second boundary reported by the RTC, which fixes the sub-second phase that
+// the I2C reads cannot resolve.
+void SystemClock::alignToSecond(uint32_t edgeMs) {
+    const auto seconds = static_cast<uint32_t>((toUnixMs(edgeMs) + 500) / 1000);
+
+    store(seconds, edgeMs);
+}
+
+int64_t SystemClock::nowMs() const noexcept {
+    return toUnixMs(millis());
+}
+
+int64_t SystemClock::toUnixMs(uint32_t tickMs) const noexcept {
+    uint32_t sequence;
+    uint32_t seconds;
+    uint32_t secondStartMs;
+
+    do {
+        sequence      = sequence_.load(std::memory_order_acquire);
+        seconds       = baseSeconds_.load(std::memory_order_relaxed);
+        secondStartMs = baseMs_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) != 0 || sequence != sequence_.load(std::memory_order_relaxed));
+
+    return static_cast<int64_t>(seconds) * 1000 + static_cast<int32_t>(tickMs - secondStartMs);
+}
+
+int64_t SystemClock::now() const noexcept {
+    return nowMs() / 1000;
+}
+
+DateTime SystemClock::dateTime() const noexcept {
+    return TimeUtil::toDateTime(now());
+}
+
+// The RTC only resolves whole seconds, so the interpolated time is kept as long as it falls into the second the RTC
+// reports and is otherwise moved to the nearest edge of that second. Rebasing every time keeps the interpolated span
+// short of the `millis()` wrap.
+void SystemClock::resync() {
+    const auto seconds = TimeUtil::toUnixTimestamp(rtc_->getDateTime());
+    const auto current = millis();
+    const auto unixMs  = std::clamp<int64_t>(toUnixMs(current), seconds * 1000, seconds * 1000 + 999);
+
+    lastResyncMs_ = current;
+    store(static_cast<uint32_t>(unixMs / 1000), current - static_cast<uint32_t>(unixMs % 1000));
+}
+
+void SystemClock::store(uint32_t seconds, uint32_t secondStartMs) noexcept {
+    sequence_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    baseSeconds_.store(seconds, std::memory_order_relaxed);
+    baseMs_.store(secondStartMs, std::memory_order_relaxed);
+    sequence_.fetch_add(1, std::memory_order_release);
+}
+
+SystemClock globalSystemClock;
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "DateTime.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+class DS3231;
+
+// Wall clock interpolated from `millis()` between reads of the DS3231. Only the main task resyncs or sets the
+// clock; any task may read it without locking or touching the I2C bus.
+class SystemClock {
+public:
+    SystemClock();
+    void begin(DS3231& rtc);
+    uint32_t resyncInterval() const noexcept;
+    void setResyncInterval(uint32_t seconds) noexcept;
+    void update();
+    void set(int64_t timestamp);
+    void alignToSecond(uint32_t edgeMs);
+    int64_t nowMs() const noexcept;
+    int64_t now() const noexcept;
+    DateTime dateTime() const noexcept;
+
+private:
+    int64_t toUnixMs(uint32_t tickMs) const noexcept;
+    void resync();
+    void store(uint32_t seconds, uint32_t secondStartMs) noexcept;
+
+    DS3231* rtc_;
+    uint32_t resyncIntervalMs_;
+    uint32_t lastResyncMs_;
+
+    // A sequence lock over the Unix second of the last sync and the `millis()` value at which that second began.
+    std::atomic_uint32_t sequence_;
+    std::atomic_uint32_t baseSeconds_;
+    std::atomic_uint32_t baseMs_;
+};
+
+extern SystemClock globalSystemClock;
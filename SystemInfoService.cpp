@@ -1,8 +1,12 @@
 #include "BleService.hpp"
+#include "BtpConstants.hpp"
+#include "ProtocolSchema.hpp"
+#include "RecordingTelemetry.hpp"
 #include "Resources.hpp"
-#include "TimeUtil.hpp"
+#include "SystemClock.hpp"
 #include "TlvWriter.hpp"
 
+#include <array>
 #include <cstdint>
 
 #include <AmebaFatFS.h>
@@ -18,19 +22,31 @@ namespace {
     class SystemInfoService : public BleService {
     public:
         void run(uint8_t type, std::span<const uint8_t> data, SendHandler sendHandler) override {
-            writer_.clear();
-            writer_.write(1, static_cast<uint64_t>(SDFs.get_free_space()));
-            writer_.write(2, static_cast<uint64_t>(SDFs.get_used_space()));
-
-            const auto timestamp =
-                TimeUtil::toUnixTimestampFromSince2020(globalNowSince2020.load(std::memory_order_acquire));
-
-            writer_.write(3, static_cast<uint64_t>(timestamp));
-            sendHandler(writer_.data());
+            const auto telemetry = globalRecordingTelemetry.snapshot();
+
+            const Protocol::SystemInfo info{
+                .sdFreeBytes                = static_cast<uint64_t>(SDFs.get_free_space()),
+                .sdUsedBytes                = static_cast<uint64_t>(SDFs.get_used_space()),
+                .timestamp                  = static_cast<uint64_t>(globalSystemClock.now()),
+                .bitrate                    = telemetry.bitrate,
+                .fallbackCount              = telemetry.fallbackCount,
+                .lastSegmentBytes           = telemetry.last.bytesWritten,
+                .lastSegmentMaxLatencyMs    = telemetry.last.maxLatencyMs,
+                .lastSegmentQueueOverflows  = telemetry.last.queueOverflows,
+                .currentSegmentMaxLatencyMs = telemetry.current.maxLatencyMs,
+                .totalQueueOverflows        = telemetry.total.queueOverflows,
+                .latencyHistogram           = telemetry.total.latencyHistogram,
+            };
+
+            TlvWriter writer{response_};
+
+            Protocol::SystemInfoSchema::encode(info, writer);
+
+            sendHandler(writer.data());
         }
 
     private:
-        TlvWriter writer_;
+        std::array<uint8_t, Btp::Constants::mtu> response_{};
     };
 } // namespace
 
@@ -1,9 +1,20 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 
+// The last magic byte is the format version. Version 2 adds extended lengths: a length byte of 0xFF is followed by
+// the real length as a big-endian u16. Writers only emit version 2 when a message carries such a record, so short
+// messages stay readable by version 1 parsers.
 struct TlvConstants {
     static constexpr std::array<uint8_t, 9> magic{'A', 'M', 'B', '8', '2', 'V', 'B', 'X', 0x01};
-    static constexpr size_t typeLengthSize = 2;
+    static constexpr size_t typeLengthSize      = 2;
+    static constexpr size_t versionOffset       = magic.size() - 1;
+    static constexpr uint8_t baseVersion        = 0x01;
+    static constexpr uint8_t extendedVersion    = 0x02;
+    static constexpr uint8_t extendedLengthByte = 0xFF;
+    static constexpr size_t extendedLengthSize  = 2;
+    static constexpr size_t maxShortLength      = 0xFE;
+    static constexpr size_t maxExtendedLength   = 0xFFFF;
 };
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "TlvConstants.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Incremental TLV parser that can be fed a message in chunks split at any byte. A record whose value lies within one
+// chunk is handed out in place; one that straddles chunks is gathered in the caller's scratch buffer, and skipped if
+// it does not fit. Nothing else of the message is kept. BTP never fragments, since a message is one characteristic
+// write of at most `Btp::Constants::mtu` bytes, so today every caller feeds a whole message as a single chunk.
+class TlvParser {
+public:
+    explicit TlvParser(std::span<uint8_t> scratch = {}) noexcept : scratch_{scratch} {}
+
+    void reset() noexcept {
+        state_       = State::magic;
+        magicOffset_ = 0;
+    }
+
+    // Returns whether the magic has been read and matched.
+    bool valid() const noexcept {
+        return state_ != State::magic && state_ != State::failed;
+    }
+
+    // Returns whether the data so far ends on a record boundary.
+    bool complete() const noexcept {
+        return state_ == State::type;
+    }
+
+    // Calls `handler(type, value)` for every record completed by `chunk`. Returns false once the magic mismatched.
+    template <typename Handler>
+    bool feed(std::span<const uint8_t> chunk, Handler&& handler) {
+        size_t offset{};
+
+        while (offset < chunk.size()) {
+            switch (state_) {
+            case State::magic: {
+                const auto value = chunk[offset++];
+
+                if (magicOffset_ == TlvConstants::versionOffset) {
+                    if (value != TlvConstants::baseVersion && value != TlvConstants::extendedVersion) {
+                        state_ = State::failed;
+                        return false;
+                    }
+
+                    version_ = value;
+                    state_   = State::type;
+                } else if (value != TlvConstants::magic[magicOffset_++]) {
+                    state_ = State::failed;
+                    return false;
+                }
+
+                break;
+            }
+            case State::type:
+                type_  = chunk[offset++];
+                state_ = State::length;
+                break;
+            case State::length:
+                if (const auto value = chunk[offset++];
+                    version_ >= TlvConstants::extendedVersion && value == TlvConstants::extendedLengthByte) {
+                    length_       = 0;
+                    lengthOffset_ = 0;
+                    state_        = State::extendedLength;
+                } else {
+                    length_ = value;
+                    beginValue(handler);
+                }
+
+                break;
+            case State::extendedLength:
+                length_ = static_cast<uint16_t>(length_ << 8 | chunk[offset++]);
+
+                if (++lengthOffset_ == TlvConstants::extendedLengthSize) {
+                    beginValue(handler);
+                }
+
+                break;
+            case State::value: {
+                const auto size = std::min<size_t>(chunk.size() - offset, length_ - valueOffset_);
+
+                if (valueOffset_ == 0 && size == length_) {
+                    handler(type_, chunk.subspan(offset, size));
+                    state_ = State::type;
+                } else {
+                    if (length_ <= scratch_.size()) {
+                        std::ranges::copy(chunk.subspan(offset, size), scratch_.begin() + valueOffset_);
+                    }
+
+                    if ((valueOffset_ += size) == length_) {
+                        if (length_ <= scratch_.size()) {
+                            handler(type_, std::span<const uint8_t>{scratch_.first(length_)});
+                        }
+
+                        state_ = State::type;
+                    }
+                }
+
+                offset += size;
+                break;
+            }
+            case State::failed:
+                return false;
+            }
+        }
+
+        return state_ != State::failed;
+    }
+
+private:
+    enum class State : uint8_t {
+        magic,
+        type,
+        length,
+        extendedLength,
+        value,
+        failed,
+    };
+
+    template <typename Handler>
+    void beginValue(Handler& handler) {
+        valueOffset_ = 0;
+
+        if (length_ == 0) {
+            handler(type_, std::span<const uint8_t>{});
+            state_ = State::type;
+        } else {
+            state_ = State::value;
+        }
+    }
+
+    std::span<uint8_t> scratch_;
+    State state_{State::magic};
+    size_t magicOffset_{};
+    uint8_t version_{};
+    uint8_t type_{};
+    uint16_t length_{};
+    uint16_t valueOffset_{};
+    uint8_t lengthOffset_{};
+};
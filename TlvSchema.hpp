@@ -0,0 +1,331 @@
+#pragma once
+
+#include "BinaryUtil.hpp"
+#include "TlvParser.hpp"
+#include "TlvWriter.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#include <WString.h>
+
+// Declarative TLV layouts. A schema binds type IDs to the fields of a struct through accessors, and both directions
+// expand at compile time into a chain of type comparisons on the parsed record, with no handler objects and no heap
+// use beyond the destination fields themselves.
+//
+//     using Schema = TlvSchema::Schema<
+//         TlvSchema::Field<1, [](auto& v) -> auto& { return v.count; }>,
+//         TlvSchema::StringField<2, [](auto& v) -> auto& { return v.name; }, 12>>;
+//
+// Records whose type no field owns are skipped, as are records whose length does not match the field.
+namespace TlvSchema {
+    // Fixed-size wire value of a field type. Custom codecs for packed fields follow the same shape.
+    template <typename T>
+    struct WireCodec {
+        using Wire = T;
+
+        static constexpr Wire toWire(const T& value) noexcept {
+            return value;
+        }
+
+        static constexpr void fromWire(Wire wire, T& value) noexcept {
+            value = wire;
+        }
+    };
+
+    template <>
+    struct WireCodec<bool> {
+        using Wire = uint8_t;
+
+        static constexpr Wire toWire(bool value) noexcept {
+            return value ? 1 : 0;
+        }
+
+        static constexpr void fromWire(Wire wire, bool& value) noexcept {
+            value = wire != 0;
+        }
+    };
+
+    template <>
+    struct WireCodec<int64_t> {
+        using Wire = uint64_t;
+
+        static constexpr Wire toWire(int64_t value) noexcept {
+            return static_cast<Wire>(value);
+        }
+
+        static constexpr void fromWire(Wire wire, int64_t& value) noexcept {
+            value = static_cast<int64_t>(wire);
+        }
+    };
+
+    // Enums travel as their underlying type; range checks are left to the owner of the struct.
+    template <typename T>
+        requires std::is_enum_v<T>
+    struct WireCodec<T> {
+        using Wire = std::underlying_type_t<T>;
+
+        static constexpr Wire toWire(T value) noexcept {
+            return static_cast<Wire>(value);
+        }
+
+        static constexpr void fromWire(Wire wire, T& value) noexcept {
+            value = static_cast<T>(wire);
+        }
+    };
+
+    namespace detail {
+        template <typename Wire>
+        constexpr Wire readWire(std::span<const uint8_t> value) noexcept {
+            if constexpr (sizeof(Wire) == 1) {
+                return value[0];
+            } else if constexpr (sizeof(Wire) == 2) {
+                return BinaryUtil::readU16Be(value);
+            } else if constexpr (sizeof(Wire) == 4) {
+                return BinaryUtil::readU32Be(value);
+            } else {
+                return BinaryUtil::readU64Be(value);
+            }
+        }
+
+        template <auto Access, typename Object>
+        using ValueType = std::remove_cvref_t<decltype(Access(std::declval<Object&>()))>;
+    } // namespace detail
+
+    // Pins the wire width of a field, whatever the member type. Generated schemas use it so that the wire layout is
+    // the one declared in `tools/protocol.json` rather than whatever the struct happens to hold.
+    template <typename Wire_>
+    struct As {
+        using Wire = Wire_;
+
+        template <typename T>
+        static constexpr Wire toWire(const T& value) noexcept {
+            return static_cast<Wire>(WireCodec<T>::toWire(value));
+        }
+
+        template <typename T>
+        static constexpr void fromWire(Wire wire, T& value) noexcept {
+            WireCodec<T>::fromWire(static_cast<typename WireCodec<T>::Wire>(wire), value);
+        }
+    };
+
+    // One member of a `Packed` value, `Width` bits wide.
+    template <auto Access, unsigned Width>
+    struct Bits {
+        static constexpr auto access    = Access;
+        static constexpr unsigned width = Width;
+    };
+
+    // Several small members sharing one record, the first part in the least significant bits.
+    template <typename Wire_, typename... Parts>
+    struct Packed {
+        using Wire = Wire_;
+
+        static_assert((Parts::width + ... + 0) <= sizeof(Wire) * 8);
+
+        template <typename T>
+        static constexpr Wire toWire(const T& value) noexcept {
+            Wire wire      = 0;
+            unsigned shift = 0;
+
+            ((wire |= (toPart<Parts>(value) & mask<Parts>()) << shift, shift += Parts::width), ...);
+
+            return wire;
+        }
+
+        template <typename T>
+        static constexpr void fromWire(Wire wire, T& value) noexcept {
+            unsigned shift = 0;
+
+            (fromPart<Parts>(static_cast<Wire>(wire >> shift) & mask<Parts>(), value, shift), ...);
+        }
+
+    private:
+        template <typename Part>
+        static constexpr Wire mask() noexcept {
+            if constexpr (Part::width >= sizeof(Wire) * 8) {
+                return static_cast<Wire>(~Wire{});
+            } else {
+                return static_cast<Wire>((Wire{1} << Part::width) - 1);
+            }
+        }
+
+        template <typename Part, typename T>
+        static constexpr Wire toPart(const T& value) noexcept {
+            using Value = detail::ValueType<Part::access, const T>;
+
+            return static_cast<Wire>(WireCodec<Value>::toWire(Part::access(value)));
+        }
+
+        template <typename Part, typename T>
+        static constexpr void fromPart(Wire bits, T& value, unsigned& shift) noexcept {
+            using Value = detail::ValueType<Part::access, T>;
+
+            WireCodec<Value>::fromWire(static_cast<typename WireCodec<Value>::Wire>(bits), Part::access(value));
+            shift += Part::width;
+        }
+    };
+
+    // A fixed-size field. `Codec` defaults to the wire codec of the accessed value.
+    template <uint8_t Type, auto Access, typename Codec = void>
+    struct Field {
+        static constexpr uint8_t type = Type;
+
+        static constexpr bool owns(uint8_t value) noexcept {
+            return value == Type;
+        }
+
+        template <typename Object>
+        static void encode(const Object& object, TlvWriter& writer, uint8_t typeBase = 0) {
+            using C = CodecFor<Object>;
+
+            writer.write(static_cast<uint8_t>(typeBase + Type), C::toWire(Access(object)));
+        }
+
+        template <typename Object>
+        static bool decode(Object& object, uint8_t recordType, std::span<const uint8_t> value) {
+            using C = CodecFor<Object>;
+
+            if (recordType != Type) {
+                return false;
+            }
+
+            if (value.size() == sizeof(typename C::Wire)) {
+                C::fromWire(detail::readWire<typename C::Wire>(value), Access(object));
+            }
+
+            return true;
+        }
+
+    private:
+        template <typename Object>
+        using CodecFor = std::conditional_t<std::is_void_v<Codec>, WireCodec<detail::ValueType<Access, Object>>, Codec>;
+    };
+
+    // A NUL-terminated string of at most `MaxSize` characters.
+    template <uint8_t Type, auto Access, size_t MaxSize>
+    struct StringField {
+        static constexpr uint8_t type = Type;
+
+        static constexpr bool owns(uint8_t value) noexcept {
+            return value == Type;
+        }
+
+        template <typename Object>
+        static void encode(const Object& object, TlvWriter& writer, uint8_t typeBase = 0) {
+            writer.write(static_cast<uint8_t>(typeBase + Type), Access(object), MaxSize);
+        }
+
+        template <typename Object>
+        static bool decode(Object& object, uint8_t recordType, std::span<const uint8_t> value) {
+            if (recordType != Type) {
+                return false;
+            }
+
+            if (std::memchr(value.data(), '\0', value.size())) {
+                Access(object) = reinterpret_cast<const char*>(value.data());
+            }
+
+            return true;
+        }
+    };
+
+    // Up to `MaxCount` elements of a vector or array, element `i` taking the types from `Base + i * Stride`. The types
+    // of the element fields are offsets within the stride. Records past the end of an array are dropped.
+    template <uint8_t Base, uint8_t Stride, size_t MaxCount, auto Access, typename... Elements>
+    struct Repeated {
+        static_assert(Base + Stride * MaxCount <= 0x100);
+        static_assert(((Elements::type < Stride) && ...));
+
+        static constexpr bool owns(uint8_t value) noexcept {
+            return value >= Base && value < Base + Stride * MaxCount
+                && (ownsElement<Elements>((value - Base) % Stride) || ...);
+        }
+
+        template <typename Object>
+        static void encode(const Object& object, TlvWriter& writer, uint8_t typeBase = 0) {
+            auto&& items     = Access(object);
+            const auto count = std::min(items.size(), MaxCount);
+
+            for (size_t i = 0; i < count; i++) {
+                const auto elementBase = static_cast<uint8_t>(typeBase + Base + i * Stride);
+
+                (Elements::encode(items[i], writer, elementBase), ...);
+            }
+        }
+
+        template <typename Object>
+        static bool decode(Object& object, uint8_t recordType, std::span<const uint8_t> value) {
+            if (!owns(recordType)) {
+                return false;
+            }
+
+            auto&& items       = Access(object);
+            const auto index   = static_cast<size_t>((recordType - Base) / Stride);
+            const auto element = static_cast<uint8_t>((recordType - Base) % Stride);
+
+            if (items.size() <= index) {
+                if constexpr (requires { items.resize(index + 1); }) {
+                    // Room for every element at the first one, instead of an allocation per doubling.
+                    items.reserve(MaxCount);
+                    items.resize(index + 1);
+                } else {
+                    return true;
+                }
+            }
+
+            (Elements::decode(items[index], element, value) || ...);
+
+            return true;
+        }
+
+    private:
+        template <typename Element>
+        static constexpr bool ownsElement(int offset) noexcept {
+            return Element::owns(static_cast<uint8_t>(offset));
+        }
+    };
+
+    template <typename... Fields>
+    struct Schema {
+        template <typename Object>
+        static void encode(const Object& object, TlvWriter& writer) {
+            (Fields::encode(object, writer), ...);
+        }
+
+        // Returns false if the buffer does not start with the protocol magic.
+        template <typename Object>
+        static bool decode(std::span<const uint8_t> buffer, Object& object) {
+            TlvParser parser;
+
+            return parser.feed(buffer, [&](uint8_t type, std::span<const uint8_t> value) {
+                decodeRecord(object, type, value);
+            }) && parser.valid();
+        }
+
+        // Applies one record, for callers that run their own `TlvParser` over a chunked message.
+        template <typename Object>
+        static void decodeRecord(Object& object, uint8_t type, std::span<const uint8_t> value) {
+            if (!value.empty()) {
+                (Fields::decode(object, type, value) || ...);
+            }
+        }
+
+    private:
+        static consteval bool disjoint() {
+            for (size_t type = 0; type < 0x100; type++) {
+                if ((static_cast<size_t>(Fields::owns(static_cast<uint8_t>(type))) + ... + 0) > 1) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        static_assert(disjoint(), "Two fields of the schema share a type ID.");
+    };
+} // namespace TlvSchema
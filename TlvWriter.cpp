@@ -4,74 +4,44 @@
 
 #include <algorithm>
 #include <array>
-#include <optional>
 #include <type_traits>
-#include <utility>
 
 namespace {
-    void writeMagicIfNeeded(std::vector<uint8_t>& buffer) {
-        if (buffer.empty()) {
-            buffer.insert(buffer.end(), TlvConstants::magic.begin(), TlvConstants::magic.end());
-        }
-    }
-
-    void writeRaw(std::vector<uint8_t>& buffer, uint8_t type, std::span<const uint8_t> value,
-        std::optional<uint8_t> endingByte = {}) {
-        writeMagicIfNeeded(buffer);
-        buffer.emplace_back(type);
-        buffer.emplace_back(static_cast<uint8_t>(value.size() + (endingByte ? 1 : 0)));
-        buffer.insert(buffer.end(), value.begin(), value.end());
-
-        if (endingByte) {
-            buffer.emplace_back(*endingByte);
-        }
-    }
-
     template <typename T>
         requires std::is_arithmetic_v<T>
-    void writePritimive(
-        std::vector<uint8_t>& buffer, uint8_t type, T value, void (*writeHandler)(std::span<uint8_t>, T)) {
-        std::array<uint8_t, sizeof(T)> intermediate{};
+    std::array<uint8_t, sizeof(T)> toBigEndian(T value, void (*writeHandler)(std::span<uint8_t>, T)) {
+        std::array<uint8_t, sizeof(T)> result{};
+
+        writeHandler(result, value);
 
-        writeHandler(intermediate, value);
-        writeRaw(buffer, type, intermediate);
+        return result;
     }
 } // namespace
 
-TlvWriter::TlvWriter() = default;
-
-TlvWriter::TlvWriter(const TlvWriter& other) : buffer_{other.buffer_} {}
-
-TlvWriter::TlvWriter(TlvWriter&& other) noexcept : buffer_{std::move(other.buffer_)} {}
+TlvWriter::TlvWriter() noexcept = default;
 
-TlvWriter::~TlvWriter() = default;
+TlvWriter::TlvWriter(std::span<uint8_t> buffer) noexcept : buffer_{buffer} {}
 
-TlvWriter& TlvWriter::operator=(const TlvWriter& other) {
-    if (this != &other) {
-        buffer_ = other.buffer_;
-    }
-
-    return *this;
+std::span<const uint8_t> TlvWriter::data() const noexcept {
+    return buffer_.first(written_);
 }
 
-TlvWriter& TlvWriter::operator=(TlvWriter&& other) noexcept {
-    if (this != &other) {
-        buffer_ = std::move(other.buffer_);
-    }
-
-    return *this;
+size_t TlvWriter::size() const noexcept {
+    return size_;
 }
 
-std::span<const uint8_t> TlvWriter::data() const noexcept {
-    return buffer_;
+bool TlvWriter::overflowed() const noexcept {
+    return overflowed_;
 }
 
-void TlvWriter::clear() {
-    buffer_.clear();
+void TlvWriter::clear() noexcept {
+    size_       = 0;
+    written_    = 0;
+    overflowed_ = false;
 }
 
 void TlvWriter::write(uint8_t type, std::span<const uint8_t> value) {
-    writeRaw(buffer_, type, value);
+    writeRecord(type, value);
 }
 
 void TlvWriter::write(uint8_t type, uint8_t value) {
@@ -79,19 +49,67 @@ void TlvWriter::write(uint8_t type, uint8_t value) {
 }
 
 void TlvWriter::write(uint8_t type, uint16_t value) {
-    writePritimive(buffer_, type, value, &BinaryUtil::writeU16Be);
+    writeRecord(type, toBigEndian(value, &BinaryUtil::writeU16Be));
 }
 
 void TlvWriter::write(uint8_t type, uint32_t value) {
-    writePritimive(buffer_, type, value, &BinaryUtil::writeU32Be);
+    writeRecord(type, toBigEndian(value, &BinaryUtil::writeU32Be));
 }
 
 void TlvWriter::write(uint8_t type, uint64_t value) {
-    writePritimive(buffer_, type, value, &BinaryUtil::writeU64Be);
+    writeRecord(type, toBigEndian(value, &BinaryUtil::writeU64Be));
 }
 
 void TlvWriter::write(uint8_t type, const String& value, size_t maxSize) {
     const auto size = std::min(value.length(), maxSize);
 
-    writeRaw(buffer_, type, std::span<const uint8_t>{reinterpret_cast<const uint8_t*>(value.c_str()), size}, '\0');
+    writeRecord(type, std::span<const uint8_t>{reinterpret_cast<const uint8_t*>(value.c_str()), size}, '\0');
+}
+
+// The magic goes in front of the first record. A value longer than the extended length can never be encoded and
+// only marks the writer as overflowed.
+void TlvWriter::writeRecord(uint8_t type, std::span<const uint8_t> value, std::optional<uint8_t> endingByte) {
+    const auto length = value.size() + (endingByte ? 1 : 0);
+
+    if (length > TlvConstants::maxExtendedLength) {
+        overflowed_ = true;
+        return;
+    }
+
+    const auto extended   = length > TlvConstants::maxShortLength;
+    const auto magicSize  = size_ == 0 ? TlvConstants::magic.size() : 0;
+    const auto headerSize = TlvConstants::typeLengthSize + (extended ? TlvConstants::extendedLengthSize : 0);
+    const auto recordSize = magicSize + headerSize + length;
+
+    size_ += recordSize;
+
+    if (overflowed_ || recordSize > buffer_.size() - written_) {
+        overflowed_ = true;
+        return;
+    }
+
+    auto output = buffer_.subspan(written_, recordSize);
+
+    if (magicSize != 0) {
+        std::ranges::copy(TlvConstants::magic, output.begin());
+        output = output.subspan(magicSize);
+    }
+
+    output[0] = type;
+
+    if (extended) {
+        buffer_[TlvConstants::versionOffset] = TlvConstants::extendedVersion;
+        output[1]                            = TlvConstants::extendedLengthByte;
+        BinaryUtil::writeU16Be(output.subspan(2), static_cast<uint16_t>(length));
+    } else {
+        output[1] = static_cast<uint8_t>(length);
+    }
+
+    std::ranges::copy(value, output.begin() + headerSize);
+
+    if (endingByte) {
+        output[headerSize + value.size()] = *endingByte;
+    }
+
+    written_ += recordSize;
 }
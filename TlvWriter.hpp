@@ -4,21 +4,22 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <span>
-#include <vector>
 
 #include <WString.h>
 
+// Serializes TLV records into a caller-provided buffer, usually the response or flash buffer itself. Records that no
+// longer fit are dropped together with every record after them, so `data()` always holds a well-formed prefix, while
+// `size()` keeps counting the bytes the whole message would take. A writer without a buffer is an exact-size dry run.
 class TlvWriter {
 public:
-    TlvWriter();
-    TlvWriter(const TlvWriter&);
-    TlvWriter(TlvWriter&&) noexcept;
-    ~TlvWriter();
-    TlvWriter& operator=(const TlvWriter&);
-    TlvWriter& operator=(TlvWriter&&) noexcept;
+    TlvWriter() noexcept;
+    explicit TlvWriter(std::span<uint8_t> buffer) noexcept;
     std::span<const uint8_t> data() const noexcept;
-    void clear();
+    size_t size() const noexcept;
+    bool overflowed() const noexcept;
+    void clear() noexcept;
     void write(uint8_t type, std::span<const uint8_t> value);
     void write(uint8_t type, uint8_t value);
     void write(uint8_t type, uint16_t value);
@@ -27,5 +28,10 @@ public:
     void write(uint8_t type, const String& value, size_t maxSize);
 
 private:
-    std::vector<uint8_t> buffer_;
+    void writeRecord(uint8_t type, std::span<const uint8_t> value, std::optional<uint8_t> endingByte = {});
+
+    std::span<uint8_t> buffer_;
+    size_t size_{};
+    size_t written_{};
+    bool overflowed_{};
 };
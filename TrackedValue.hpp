@@ -1,34 +1,173 @@
 #pragma once
 
+#include <array>
 #include <atomic>
-#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <utility>
 
-template <typename T>
+#if 1
+#include <FreeRTOS.h>
+#endif
+
+#include <semphr.h>
+#include <task.h>
+
+// Versioned snapshots of a value shared between tasks. Readers pin the current version without locking or allocating,
+// writers build the next version in a free slot and publish it with a single exchange. Every publication bumps the
+// generation, so readers detect changes by comparing generations.
+//
+// Pins of the current slot are counted in the same word as its index, so `snapshot` takes both with one `fetch_add`
+// and never retries. When a slot is replaced, the writer moves the pins it collected to the slot, where readers drop
+// theirs; the slot is free once the two cancel out. At most 2^24 snapshots may be taken of one version.
+template <typename T, size_t SlotCount = 4>
 class TrackedValue {
+    static_assert(SlotCount >= 2 && SlotCount <= 0x100);
+
+    struct Slot {
+        std::optional<T> value;
+        uint32_t generation{};
+        std::atomic_int32_t pins{};
+        bool retired{true};
+    };
+
 public:
-    using ElementPair = std::pair<T, bool>;
+    class Snapshot {
+    public:
+        Snapshot() = default;
+
+        Snapshot(Snapshot&& other) noexcept : slot_{std::exchange(other.slot_, nullptr)} {}
+
+        Snapshot& operator=(Snapshot&& other) noexcept {
+            if (this != &other) {
+                release();
+                slot_ = std::exchange(other.slot_, nullptr);
+            }
+
+            return *this;
+        }
+
+        ~Snapshot() {
+            release();
+        }
+
+        explicit operator bool() const noexcept {
+            return slot_ != nullptr;
+        }
+
+        const T& operator*() const noexcept {
+            return *slot_->value;
+        }
+
+        const T* operator->() const noexcept {
+            return &*slot_->value;
+        }
+
+        uint32_t generation() const noexcept {
+            return slot_->generation;
+        }
+
+    private:
+        friend class TrackedValue;
+
+        explicit Snapshot(Slot* slot) noexcept : slot_{slot} {}
+
+        void release() noexcept {
+            if (slot_) {
+                slot_->pins.fetch_sub(1, std::memory_order_release);
+            }
+        }
+
+        Slot* slot_{};
+    };
 
     template <typename U>
-    TrackedValue(U&& value) : value_{std::make_shared<ElementPair>(std::forward<U>(value), false)} {}
+    TrackedValue(U&& value) : mutex_{xSemaphoreCreateMutex()} {
+        slots_[0].value.emplace(std::forward<U>(value));
+        slots_[0].retired = false;
+    }
 
-    std::shared_ptr<ElementPair> current() const {
-        return std::atomic_load_explicit(&value_, std::memory_order::acquire);
+    ~TrackedValue() {
+        if (mutex_) {
+            vSemaphoreDelete(mutex_);
+            mutex_ = nullptr;
+        }
+    }
+
+    TrackedValue(const TrackedValue&)            = delete;
+    TrackedValue& operator=(const TrackedValue&) = delete;
+
+    Snapshot snapshot() {
+        const auto state = state_.fetch_add(1, std::memory_order_acquire);
+
+        return Snapshot{&slots_[state >> indexShift]};
+    }
+
+    // The generation of the latest version, for polling without pinning anything.
+    uint32_t generation() const noexcept {
+        return generation_.load(std::memory_order_acquire);
     }
 
     template <typename U>
     void update(U&& value) {
-        std::atomic_store_explicit(
-            &value_, std::make_shared<ElementPair>(std::forward<U>(value), true), std::memory_order::release);
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+
+        auto&& slot = freeSlot();
+
+        slot.value = std::forward<U>(value);
+        publish(slot);
+        xSemaphoreGive(mutex_);
     }
 
-    void confirm() {
-        if (const auto current = std::atomic_load_explicit(&value_, std::memory_order::acquire); current->second) {
-            std::atomic_store_explicit(
-                &value_, std::make_shared<ElementPair>(current->first, false), std::memory_order::release);
-        }
+    // Applies `modifier` to a copy of the latest version and publishes the result, with no other writer in between.
+    template <typename Modifier>
+    void modify(Modifier&& modifier) {
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+
+        auto&& slot = freeSlot();
+
+        slot.value = slots_[state_.load(std::memory_order_relaxed) >> indexShift].value;
+        modifier(*slot.value);
+        publish(slot);
+        xSemaphoreGive(mutex_);
     }
 
 private:
-    std::shared_ptr<std::pair<T, bool>> value_;
+    static constexpr uint32_t indexShift = 24;
+    static constexpr uint32_t pinMask    = (1U << indexShift) - 1;
+
+    // Readers only hold old versions briefly, so running out of slots is rare and a writer just waits a tick.
+    Slot& freeSlot() {
+        const auto current = state_.load(std::memory_order_relaxed) >> indexShift;
+
+        while (true) {
+            for (size_t i = 0; i < SlotCount; i++) {
+                if (i != current && slots_[i].retired && slots_[i].pins.load(std::memory_order_acquire) == 0) {
+                    return slots_[i];
+                }
+            }
+
+            vTaskDelay(1);
+        }
+    }
+
+    void publish(Slot& slot) {
+        const auto index = static_cast<uint32_t>(&slot - slots_.data());
+
+        slot.generation = generation_.load(std::memory_order_relaxed) + 1;
+        slot.retired    = false;
+
+        const auto previous = state_.exchange(index << indexShift, std::memory_order_acq_rel);
+        auto&& replaced     = slots_[previous >> indexShift];
+
+        replaced.pins.fetch_add(static_cast<int32_t>(previous & pinMask), std::memory_order_relaxed);
+        replaced.retired = true;
+        generation_.store(slot.generation, std::memory_order_release);
+    }
+
+    std::array<Slot, SlotCount> slots_{};
+    std::atomic_uint32_t state_{};
+    std::atomic_uint32_t generation_{};
+    SemaphoreHandle_t mutex_;
 };
@@ -11,7 +11,7 @@
 #endif
 
 #include <LOGUARTClass.h>
-#include <semphr.h>
+#include <task.h>
 
 namespace {
     class UpdateScheduleService : public BleService {
@@ -26,12 +26,11 @@ namespace {
 
             auto tmp = AppConfig::fromBuffer(data);
 
-            xSemaphoreTake(globalAppMutex, portMAX_DELAY);
-            auto config = globalAppConfig.current()->first;
-            xSemaphoreGive(globalAppMutex);
-
-            config.recording.schedule = std::move(tmp.recording.schedule);
-            globalAppConfig.update(std::move(config));
+            globalAppConfig.modify([&](AppConfig& config) {
+                config.recording.schedule = std::move(tmp.recording.schedule);
+                config.recording.rules    = std::move(tmp.recording.rules);
+            });
+            xTaskNotifyGive(globalMainTask);
 
             sendHandler(std::array<uint8_t, 2>{'O', 'K'});
         }
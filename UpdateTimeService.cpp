@@ -1,28 +1,32 @@
 #include "BleService.hpp"
+#include "ProtocolSchema.hpp"
 #include "Resources.hpp"
 #include "TimeUtil.hpp"
-#include "TlvReader.hpp"
-#include "TlvWriter.hpp"
 
 #include <cstdint>
 #include <span>
 
+#if 1
+#include <FreeRTOS.h>
+#endif
+
+#include <task.h>
+
 namespace {
     class UpdateTimeService : public BleService {
     public:
         void run(uint8_t type, std::span<const uint8_t> data, SendHandler sendHandler) override {
-            TlvReader reader{data};
-
-            reader.registerHandler(1, TlvReader::DataHandler<uint64_t>{
-                                          [&](uint8_t type, uint64_t value) {
-                                              const auto timestamp = static_cast<int64_t>(value);
+            Protocol::TimeRequest request;
 
-                                              globalPendingTimestampSince2020.store(
-                                                  TimeUtil::toTimestampSince2020(timestamp), std::memory_order_release);
-                                          },
-                                      });
+            if (Protocol::TimeRequestSchema::decode(data, request)) {
+                // A request without a timestamp is acknowledged without touching the clock.
+                if (request.timestamp != 0) {
+                    globalPendingTimestampSince2020.store(
+                        TimeUtil::toTimestampSince2020(static_cast<int64_t>(request.timestamp)),
+                        std::memory_order_release);
+                    xTaskNotifyGive(globalMainTask);
+                }
 
-            if (reader.readAll()) {
                 return sendHandler(std::array<uint8_t, 2>{'O', 'K'});
             }
 
@@ -1,6 +1,7 @@
 #include "CryptoUtil.hpp"
 #include "HttpMessageServer.hpp"
 #include "HttpService.hpp"
+#include "IdlePowerManager.hpp"
 
 #include <Client.h>
 #include <VideoStream.h>
@@ -191,6 +192,8 @@ namespace {
                         first = false;
                     }
 
+                    // A viewer keeps the camera at full rate for as long as it stays connected.
+                    globalIdlePowerManager.noteActivity();
                     vTaskDelay(5 / portTICK_PERIOD_MS);
                 }
 
@@ -0,0 +1,277 @@
+// Generated by tools/generate_protocol.py from tools/protocol.json. Do not edit.
+import { TlvReader, TlvWriter } from "./tlv";
+
+// Grows `items` with empty objects so that `items[index]` exists.
+function element(items, index) {
+    while (items.length <= index) {
+        items.push({});
+    }
+
+    return items[index];
+}
+
+// Persisted configuration and schedule response. Schedule requests only set `schedule` and `rules`.
+export function encodeAppConfig(message) {
+    const writer = new TlvWriter();
+
+    writer.writeMagic();
+
+    if (message.hotspotEnabled !== undefined) {
+        writer.writeUInt8(1, message.hotspotEnabled ? 1 : 0);
+    }
+
+    if (message.hotspotSsid !== undefined) {
+        writer.writeString(2, message.hotspotSsid, 12);
+    }
+
+    if (message.hotspotPassword !== undefined) {
+        writer.writeString(3, message.hotspotPassword, 8);
+    }
+
+    if (message.baseName !== undefined) {
+        writer.writeString(4, message.baseName, 12);
+    }
+
+    if (message.singleFileDuration !== undefined) {
+        writer.writeUInt32(5, message.singleFileDuration);
+    }
+
+    if (message.directoryLayout !== undefined) {
+        writer.writeUInt8(6, message.directoryLayout);
+    }
+
+    if (message.minFreeSpaceMb !== undefined) {
+        writer.writeUInt32(7, message.minFreeSpaceMb);
+    }
+
+    if (message.maxSegmentSizeMb !== undefined) {
+        writer.writeUInt32(8, message.maxSegmentSizeMb);
+    }
+
+    if (message.rotationAlignmentSec !== undefined) {
+        writer.writeUInt32(9, message.rotationAlignmentSec);
+    }
+
+    if (message.keyframeAligned !== undefined) {
+        writer.writeUInt8(10, message.keyframeAligned ? 1 : 0);
+    }
+
+    if (message.clockResyncSec !== undefined) {
+        writer.writeUInt32(11, message.clockResyncSec);
+    }
+
+    const schedule = message.schedule ?? [];
+
+    for (let i = 0; i < Math.min(schedule.length, 8); i++) {
+        const item = schedule[i];
+
+        if (item.startTimestamp !== undefined) {
+            writer.writeUInt64(100 + i * 2, item.startTimestamp);
+        }
+
+        if (item.duration !== undefined) {
+            writer.writeUInt32(101 + i * 2, item.duration);
+        }
+    }
+
+    const rules = message.rules ?? [];
+
+    for (let i = 0; i < Math.min(rules.length, 8); i++) {
+        const item = rules[i];
+
+        if (item.anchorTimestamp !== undefined) {
+            writer.writeUInt64(150 + i * 3, item.anchorTimestamp);
+        }
+
+        if (item.duration !== undefined) {
+            writer.writeUInt32(151 + i * 3, item.duration);
+        }
+
+        if (item.kind !== undefined || item.weekdayMask !== undefined || item.intervalHours !== undefined) {
+            writer.writeUInt32(152 + i * 3, (((item.kind ?? 0) & 0xFF) | (((item.weekdayMask ?? 0) & 0xFF) << 8) | (((item.intervalHours ?? 0) & 0xFFFF) << 16)) >>> 0);
+        }
+    }
+
+    return writer.toArrayBuffer();
+}
+
+export function decodeAppConfig(arrayBuffer) {
+    const reader = new TlvReader(arrayBuffer);
+    const message = {
+        schedule: [],
+        rules: [],
+    };
+
+    reader.registerHandler(1, 'number', (_, value) => message.hotspotEnabled = value !== 0);
+    reader.registerHandler(2, 'string', (_, value) => message.hotspotSsid = value);
+    reader.registerHandler(3, 'string', (_, value) => message.hotspotPassword = value);
+    reader.registerHandler(4, 'string', (_, value) => message.baseName = value);
+    reader.registerHandler(5, 'number', (_, value) => message.singleFileDuration = value);
+    reader.registerHandler(6, 'number', (_, value) => message.directoryLayout = value);
+    reader.registerHandler(7, 'number', (_, value) => message.minFreeSpaceMb = value);
+    reader.registerHandler(8, 'number', (_, value) => message.maxSegmentSizeMb = value);
+    reader.registerHandler(9, 'number', (_, value) => message.rotationAlignmentSec = value);
+    reader.registerHandler(10, 'number', (_, value) => message.keyframeAligned = value !== 0);
+    reader.registerHandler(11, 'number', (_, value) => message.clockResyncSec = value);
+
+    for (let i = 0; i < 8; i++) {
+        reader.registerHandler(100 + i * 2, 'number', (_, value) => element(message.schedule, i).startTimestamp = Number(value));
+        reader.registerHandler(101 + i * 2, 'number', (_, value) => element(message.schedule, i).duration = value);
+    }
+
+    for (let i = 0; i < 8; i++) {
+        reader.registerHandler(150 + i * 3, 'number', (_, value) => element(message.rules, i).anchorTimestamp = Number(value));
+        reader.registerHandler(151 + i * 3, 'number', (_, value) => element(message.rules, i).duration = value);
+        reader.registerHandler(152 + i * 3, 'number', (_, value) => {
+            const item = element(message.rules, i);
+
+            item.kind = value & 0xFF;
+            item.weekdayMask = (value >>> 8) & 0xFF;
+            item.intervalHours = (value >>> 16) & 0xFFFF;
+        });
+    }
+
+    reader.readAll();
+
+    return message;
+}
+
+// Sets the system time, in seconds since the Unix epoch.
+export function encodeTimeRequest(message) {
+    const writer = new TlvWriter();
+
+    writer.writeMagic();
+
+    if (message.timestamp !== undefined) {
+        writer.writeUInt64(1, message.timestamp);
+    }
+
+    return writer.toArrayBuffer();
+}
+
+export function decodeTimeRequest(arrayBuffer) {
+    const reader = new TlvReader(arrayBuffer);
+    const message = {};
+
+    reader.registerHandler(1, 'number', (_, value) => message.timestamp = Number(value));
+
+    reader.readAll();
+
+    return message;
+}
+
+// Storage, clock and recording telemetry. The histogram has log2 buckets in milliseconds.
+export function encodeSystemInfo(message) {
+    const writer = new TlvWriter();
+
+    writer.writeMagic();
+
+    if (message.sdFreeBytes !== undefined) {
+        writer.writeUInt64(1, message.sdFreeBytes);
+    }
+
+    if (message.sdUsedBytes !== undefined) {
+        writer.writeUInt64(2, message.sdUsedBytes);
+    }
+
+    if (message.timestamp !== undefined) {
+        writer.writeUInt64(3, message.timestamp);
+    }
+
+    if (message.bitrate !== undefined) {
+        writer.writeUInt32(4, message.bitrate);
+    }
+
+    if (message.fallbackCount !== undefined) {
+        writer.writeUInt32(5, message.fallbackCount);
+    }
+
+    if (message.lastSegmentBytes !== undefined) {
+        writer.writeUInt64(6, message.lastSegmentBytes);
+    }
+
+    if (message.lastSegmentMaxLatencyMs !== undefined) {
+        writer.writeUInt32(7, message.lastSegmentMaxLatencyMs);
+    }
+
+    if (message.lastSegmentQueueOverflows !== undefined) {
+        writer.writeUInt32(8, message.lastSegmentQueueOverflows);
+    }
+
+    if (message.currentSegmentMaxLatencyMs !== undefined) {
+        writer.writeUInt32(9, message.currentSegmentMaxLatencyMs);
+    }
+
+    if (message.totalQueueOverflows !== undefined) {
+        writer.writeUInt32(10, message.totalQueueOverflows);
+    }
+
+    const latencyHistogram = message.latencyHistogram ?? [];
+
+    for (let i = 0; i < Math.min(latencyHistogram.length, 10); i++) {
+        if (latencyHistogram[i] !== undefined) {
+            writer.writeUInt32(20 + i, latencyHistogram[i]);
+        }
+    }
+
+    return writer.toArrayBuffer();
+}
+
+export function decodeSystemInfo(arrayBuffer) {
+    const reader = new TlvReader(arrayBuffer);
+    const message = {
+        latencyHistogram: [],
+    };
+
+    reader.registerHandler(1, 'number', (_, value) => message.sdFreeBytes = Number(value));
+    reader.registerHandler(2, 'number', (_, value) => message.sdUsedBytes = Number(value));
+    reader.registerHandler(3, 'number', (_, value) => message.timestamp = Number(value));
+    reader.registerHandler(4, 'number', (_, value) => message.bitrate = value);
+    reader.registerHandler(5, 'number', (_, value) => message.fallbackCount = value);
+    reader.registerHandler(6, 'number', (_, value) => message.lastSegmentBytes = Number(value));
+    reader.registerHandler(7, 'number', (_, value) => message.lastSegmentMaxLatencyMs = value);
+    reader.registerHandler(8, 'number', (_, value) => message.lastSegmentQueueOverflows = value);
+    reader.registerHandler(9, 'number', (_, value) => message.currentSegmentMaxLatencyMs = value);
+    reader.registerHandler(10, 'number', (_, value) => message.totalQueueOverflows = value);
+
+    for (let i = 0; i < 10; i++) {
+        reader.registerHandler(20 + i, 'number', (_, value) => message.latencyHistogram[i] = value);
+    }
+
+    reader.readAll();
+
+    return message;
+}
+
+// One packed record per boot, newest first. The firmware packs the records itself. Over BLE the request is the index of
+// one boot and the answer holds that record alone.
+export function encodeBootProfile(message) {
+    const writer = new TlvWriter();
+
+    writer.writeMagic();
+
+    const boots = message.boots ?? [];
+
+    for (let i = 0; i < Math.min(boots.length, 8); i++) {
+        if (boots[i] !== undefined) {
+            writer.write(1 + i, boots[i]);
+        }
+    }
+
+    return writer.toArrayBuffer();
+}
+
+export function decodeBootProfile(arrayBuffer) {
+    const reader = new TlvReader(arrayBuffer);
+    const message = {
+        boots: [],
+    };
+
+    for (let i = 0; i < 8; i++) {
+        reader.registerHandler(1 + i, 'bytes', (_, value) => message.boots[i] = value);
+    }
+
+    reader.readAll();
+
+    return message;
+}
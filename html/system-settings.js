@@ -1,4 +1,4 @@
-import { TlvReader, TlvWriter } from "./tlv";
+import { decodeAppConfig, decodeBootProfile, decodeSystemInfo, encodeAppConfig, encodeTimeRequest } from "./protocol";
 import { resizeArray } from "./util";
 
 export const RequestType = Object.freeze({
@@ -6,8 +6,14 @@ export const RequestType = Object.freeze({
     SET_SYSTEM_TIME: 1,
     GET_RECORDING_SCHEDULE: 2,
     SET_RECORDING_SCHEDULE: 3,
+    GET_BOOT_PROFILE: 4,
 });
 
+const failStatus = new TextEncoder().encode('FAIL');
+
+// Plans and rules together, so that the schedule response fits one transfer. Mirrors `AppConfig::maxScheduleEntries`.
+export const maxScheduleEntries = 6;
+
 export class SdCardInfo {
     constructor(freeSpaceBytes, usedSpaceBytes) {
         if (typeof freeSpaceBytes !== 'number') {
@@ -51,6 +57,20 @@ export class HotspotInfo {
     }
 }
 
+export class RecordingStats {
+    constructor() {
+        this.bitrate = 0;
+        this.fallbackCount = 0;
+        this.lastSegmentBytes = 0;
+        this.lastSegmentMaxLatencyMs = 0;
+        this.lastSegmentQueueOverflows = 0;
+        this.currentSegmentMaxLatencyMs = 0;
+        this.totalQueueOverflows = 0;
+        // Log2 buckets in milliseconds: [0, 1), [1, 2), [2, 4) ... [256, inf).
+        this.latencyHistogram = new Array(10).fill(0);
+    }
+}
+
 export class SystemInfo {
     constructor(sdcard, timestamp, hotspot) {
         if (!(sdcard instanceof SdCardInfo)) {
@@ -68,6 +88,7 @@ export class SystemInfo {
         this.sdcard = sdcard;
         this.timestamp = timestamp;
         this.hotspot = hotspot;
+        this.recording = new RecordingStats();
     }
 }
 
@@ -86,8 +107,29 @@ export class RecordingPlan {
     }
 }
 
+export const RecurrenceKind = Object.freeze({
+    DAILY: 0,
+    WEEKDAYS: 1,
+    EVERY_N_HOURS: 2,
+});
+
+export class RecurringRule {
+    constructor(anchorTimestamp = 0, duration = 0, kind = RecurrenceKind.DAILY, weekdayMask = 0, intervalHours = 0) {
+        if (!Object.values(RecurrenceKind).includes(kind)) {
+            throw new TypeError('`kind` must be a `RecurrenceKind`.');
+        }
+
+        this.anchorTimestamp = anchorTimestamp;
+        this.duration = duration;
+        this.kind = kind;
+        this.weekdayMask = weekdayMask;
+        this.intervalHours = intervalHours;
+    }
+}
+
 export class RecordingSchedule {
     constructor() {
+        this.rules = [];
         this.schedule = new Proxy([], {
             set(target, prop, value) {
                 if (!(value instanceof RecordingPlan)) {
@@ -104,6 +146,34 @@ export class RecordingSchedule {
     resize(newLength) {
         resizeArray(this.schedule, newLength, new RecordingPlan());
     }
+
+    resizeRules(newLength) {
+        while (this.rules.length < newLength) {
+            this.rules.push(new RecurringRule());
+        }
+
+        this.rules.length = newLength;
+    }
+}
+
+export class BootStage {
+    constructor(name, startUs, endUs) {
+        this.name = name;
+        this.startUs = startUs;
+        this.endUs = endUs;
+    }
+
+    durationUs() {
+        return (this.endUs - this.startUs) >>> 0;
+    }
+}
+
+export class BootRecord {
+    constructor(sequence, alarmWake, stages) {
+        this.sequence = sequence;
+        this.alarmWake = alarmWake;
+        this.stages = stages;
+    }
 }
 
 export class SystemTimeInfo {
@@ -123,62 +193,71 @@ export class SystemTimeInfo {
 export class SystemSettings {
     async getSystemInfo() {
         const buffer = await this._send('/api/v1/getSystemInfo', RequestType.GET_SYSTEM_INFO, new Uint8Array());
-        const reader = new TlvReader(buffer.buffer);
-        const result = new SystemInfo(new SdCardInfo(), 0, new HotspotInfo());
-
-        reader.registerHandler(1, 'number', (_, value) => result.sdcard.freeSpaceBytes = value);
-        reader.registerHandler(2, 'number', (_, value) => result.sdcard.usedSpaceBytes = value);
-        reader.registerHandler(3, 'number', (_, value) => result.timestamp = value);
-        reader.readAll();
+        const message = decodeSystemInfo(buffer.buffer);
+        const sdcard = new SdCardInfo(message.sdFreeBytes ?? 0, message.sdUsedBytes ?? 0);
+        const result = new SystemInfo(sdcard, message.timestamp ?? 0, new HotspotInfo('', '', false));
+        const recording = result.recording;
+
+        recording.bitrate = message.bitrate ?? 0;
+        recording.fallbackCount = message.fallbackCount ?? 0;
+        recording.lastSegmentBytes = message.lastSegmentBytes ?? 0;
+        recording.lastSegmentMaxLatencyMs = message.lastSegmentMaxLatencyMs ?? 0;
+        recording.lastSegmentQueueOverflows = message.lastSegmentQueueOverflows ?? 0;
+        recording.currentSegmentMaxLatencyMs = message.currentSegmentMaxLatencyMs ?? 0;
+        recording.totalQueueOverflows = message.totalQueueOverflows ?? 0;
+        message.latencyHistogram.forEach((value, i) => recording.latencyHistogram[i] = value);
 
         return result;
     }
 
-    async setSystemTime(systemTimeInfo) {
-        const writer = new TlvWriter();
+    async getBootProfile() {
+        const buffer = await this._send('/api/v1/getBootProfile', RequestType.GET_BOOT_PROFILE, new Uint8Array());
+        const nameSize = 12;
+        const stageSize = nameSize + 8;
+
+        return decodeBootProfile(buffer.buffer).boots.map(bytes => {
+            const view = new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+            const stages = [];
+
+            for (let j = 0; j < bytes[5]; j++) {
+                const offset = 6 + j * stageSize;
+                const name = new TextDecoder().decode(bytes.slice(offset, offset + nameSize)).replace(/\0+$/, '');
+
+                stages.push(new BootStage(name, view.getUint32(offset + nameSize), view.getUint32(offset + nameSize + 4)));
+            }
+
+            return new BootRecord(view.getUint32(0), bytes[4] !== 0, stages);
+        });
+    }
 
-        writer.writeMagic();
-        writer.writeUInt64(1, systemTimeInfo.timestamp);
-        await this._send('/api/vi/setSystemTime', RequestType.SET_SYSTEM_TIME, writer.toArrayBuffer());
+    async setSystemTime(systemTimeInfo) {
+        await this._send('/api/vi/setSystemTime', RequestType.SET_SYSTEM_TIME, encodeTimeRequest({ timestamp: systemTimeInfo.timestamp }));
     }
 
     async getRecordingSchedule() {
         const buffer = await this._send('/api/v1/getRecordingSchedule', RequestType.GET_RECORDING_SCHEDULE, new Uint8Array());
-        const reader = new TlvReader(buffer.buffer);
+        const message = decodeAppConfig(buffer.buffer);
         const result = new RecordingSchedule();
 
-        for (let i = 0; i < 8; i++) {
-            reader.registerHandler(100 + i * 2, 'number', (_, timestamp) => {
-                result.resize(i + 1);
-                result[i].startTimestamp = timestamp;
-            });
-
-            reader.registerHandler(101 + i * 2, 'number', (_, duration) => {
-                result.resize(i + 1);
-                result[i].duration = duration;
-            });
-        }
-
-        reader.readAll();
+        message.schedule.forEach((item, i) => result.schedule[i] = new RecordingPlan(item.startTimestamp ?? 0, item.duration ?? 0));
+        message.rules.forEach((item, i) => {
+            result.rules[i] = new RecurringRule(item.anchorTimestamp, item.duration, item.kind, item.weekdayMask, item.intervalHours);
+        });
 
         return result;
     }
 
     async setRecordingSchedule(schedule) {
-        const writer = new TlvWriter();
-
-        writer.writeMagic();
-
-        const length = Math.min(schedule.schedule.length, 8);
-
-        for (let i = 0; i < length; i++) {
-            const item = schedule.schedule[i];
-
-            writer.writeUInt64(100 + i * 2, item.startTimestamp);
-            writer.writeUInt32(101 + i * 2, item.duration);
+        if (schedule.schedule.length + schedule.rules.length > maxScheduleEntries) {
+            throw new RangeError(`At most ${maxScheduleEntries} recording plans and rules fit the device.`);
         }
 
-        await this._send('/api/v1/setRecordingSchedule', RequestType.SET_RECORDING_SCHEDULE, writer.toArrayBuffer());
+        const message = {
+            schedule: schedule.schedule,
+            rules: schedule.rules,
+        };
+
+        await this._send('/api/v1/setRecordingSchedule', RequestType.SET_RECORDING_SCHEDULE, encodeAppConfig(message));
     }
 
     async _send(url, type, data) {
@@ -199,6 +278,13 @@ export class SystemSettings {
             throw new Error(`Error ${response.status} (${response.statusText}): ${await response.text()}`);
         }
 
-        return response.bytes();
+        const result = await response.bytes();
+
+        // Services answer `FAIL` instead of a TLV message when they cannot serve the request.
+        if (result.length === failStatus.length && result.every((byte, i) => byte === failStatus[i])) {
+            throw new Error(`Request ${type} failed on the device.`);
+        }
+
+        return result;
     }
 }
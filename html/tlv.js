@@ -1,6 +1,15 @@
 export const TlvConstants = {
     Magic: new Uint8Array(['A'.charCodeAt(0), 'M'.charCodeAt(0), 'B'.charCodeAt(0), '8'.charCodeAt(0), '2'.charCodeAt(0), 'V'.charCodeAt(0), 'B'.charCodeAt(0), 'X'.charCodeAt(0), 0x01]),
-    TypeLengthSize: 2
+    TypeLengthSize: 2,
+    // The last magic byte is the format version. Version 2 lets a length byte of 0xFF announce a big-endian u16
+    // length, and is only written when a message needs it.
+    VersionOffset: 8,
+    BaseVersion: 0x01,
+    ExtendedVersion: 0x02,
+    ExtendedLengthByte: 0xFF,
+    ExtendedLengthSize: 2,
+    MaxShortLength: 0xFE,
+    MaxExtendedLength: 0xFFFF
 };
 
 export class TlvReader {
@@ -20,8 +29,8 @@ export class TlvReader {
             throw new TypeError('`handler` must be a function.');
         }
 
-        if (!['number', 'string'].includes(dataType)) {
-            throw new TypeError('`dataType` must be "number" or "string".');
+        if (!['number', 'string', 'bytes'].includes(dataType)) {
+            throw new TypeError('`dataType` must be "number", "string" or "bytes".');
         }
 
         this._handlers.set(type, { dataType, handler });
@@ -30,12 +39,18 @@ export class TlvReader {
     _ensureMagic() {
         const magic = TlvConstants.Magic;
 
-        for (let i = 0; i < magic.length; i++) {
+        for (let i = 0; i < TlvConstants.VersionOffset; i++) {
             if (this._buffer[i] !== magic[i]) {
                 throw new Error('Invalid TLV magic number.');
             }
         }
 
+        this._version = this._buffer[TlvConstants.VersionOffset];
+
+        if (this._version !== TlvConstants.BaseVersion && this._version !== TlvConstants.ExtendedVersion) {
+            throw new Error(`Unsupported TLV version ${this._version}.`);
+        }
+
         this._offset = magic.length;
     }
 
@@ -45,13 +60,23 @@ export class TlvReader {
 
         while (offset + TlvConstants.TypeLengthSize <= buffer.length) {
             const type = buffer[offset];
-            const length = buffer[offset + 1];
+            let length = buffer[offset + 1];
+            let headerSize = TlvConstants.TypeLengthSize;
 
-            if (offset + TlvConstants.TypeLengthSize + length > buffer.length) {
+            if (this._version >= TlvConstants.ExtendedVersion && length === TlvConstants.ExtendedLengthByte) {
+                if (offset + headerSize + TlvConstants.ExtendedLengthSize > buffer.length) {
+                    break;
+                }
+
+                length = (buffer[offset + headerSize] << 8) | buffer[offset + headerSize + 1];
+                headerSize += TlvConstants.ExtendedLengthSize;
+            }
+
+            if (offset + headerSize + length > buffer.length) {
                 break;
             }
 
-            const valueBytes = buffer.slice(offset + TlvConstants.TypeLengthSize, offset + TlvConstants.TypeLengthSize + length);
+            const valueBytes = buffer.slice(offset + headerSize, offset + headerSize + length);
             const entry = this._handlers.get(type);
 
             if (entry) {
@@ -72,12 +97,14 @@ export class TlvReader {
                     }
                 } else if (entry.dataType === 'string') {
                     value = new TextDecoder().decode(valueBytes).replace(/\0$/, '');
+                } else if (entry.dataType === 'bytes') {
+                    value = valueBytes;
                 }
 
                 entry.handler(type, value);
             }
 
-            offset += TlvConstants.TypeLengthSize + length;
+            offset += headerSize + length;
         }
     }
 }
@@ -85,10 +112,12 @@ export class TlvReader {
 export class TlvWriter {
     constructor() {
         this._chunks = [];
+        this._magic = null;
     }
 
     writeMagic() {
-        this._chunks.push(TlvConstants.Magic);
+        this._magic = new Uint8Array(TlvConstants.Magic);
+        this._chunks.push(this._magic);
     }
 
     write(type, value) {
@@ -96,11 +125,20 @@ export class TlvWriter {
             throw new TypeError('`value` must be Uint8Array.');
         }
 
-        if (value.length > 255) {
+        if (value.length > TlvConstants.MaxExtendedLength) {
             throw new RangeError('`value` too long.');
         }
 
-        this._chunks.push(new Uint8Array([type, value.length]));
+        if (value.length > TlvConstants.MaxShortLength) {
+            if (this._magic) {
+                this._magic[TlvConstants.VersionOffset] = TlvConstants.ExtendedVersion;
+            }
+
+            this._chunks.push(new Uint8Array([type, TlvConstants.ExtendedLengthByte, value.length >> 8, value.length & 0xFF]));
+        } else {
+            this._chunks.push(new Uint8Array([type, value.length]));
+        }
+
         this._chunks.push(value);
     }
 
@@ -0,0 +1,88 @@
+#include "TestUtil.hpp"
+
+#include "AppConfig.hpp"
+#include "TlvWriter.hpp"
+
+#include <vector>
+
+namespace {
+    AppConfig::Changes changesOf(ConfigSection first, auto... others) {
+        AppConfig::Changes result;
+
+        result.add(first);
+        (result.add(others), ...);
+
+        return result;
+    }
+
+    // A schedule with more entries than one transfer holds keeps the first ones, plans before rules.
+    void testScheduleCap() {
+        auto config = AppConfig::createDefault();
+
+        for (uint32_t i = 0; i < 8; i++) {
+            config.recording.schedule.push_back({i, 10});
+            config.recording.rules.push_back({i, 5, RecurrenceKind::daily, 0, 0});
+        }
+
+        TlvWriter sizer;
+
+        config.writeTlv(sizer);
+
+        std::vector<uint8_t> buffer(sizer.size());
+        TlvWriter writer{buffer};
+
+        config.writeTlv(writer);
+
+        const auto capped = AppConfig::fromBuffer(writer.data());
+
+        EXPECT(capped.recording.schedule.size() == AppConfig::maxScheduleEntries);
+        EXPECT(capped.recording.rules.empty());
+        EXPECT(capped.recording.schedule.back().startTimestamp == AppConfig::maxScheduleEntries - 1);
+
+        config.recording.schedule.resize(2);
+
+        TlvWriter mixed{buffer};
+
+        config.writeTlv(mixed);
+
+        const auto mixedCapped = AppConfig::fromBuffer(mixed.data());
+
+        EXPECT(mixedCapped.recording.schedule.size() == 2);
+        EXPECT(mixedCapped.recording.rules.size() == AppConfig::maxScheduleEntries - 2);
+    }
+} // namespace
+
+// `diff` reports exactly the sections whose stored records change.
+int main() {
+    const auto base = AppConfig::createDefault();
+    auto config     = base;
+
+    EXPECT(config.diff(base).empty());
+
+    config.recording.schedule.push_back({100, 10});
+    EXPECT(config.diff(base).sections == changesOf(ConfigSection::schedule).sections);
+    EXPECT(base.diff(config).sections == changesOf(ConfigSection::schedule).sections);
+
+    config              = base;
+    config.hotspot.ssid = "X";
+    config.clock.resyncSec++;
+    EXPECT(config.diff(base).sections == changesOf(ConfigSection::hotspot, ConfigSection::clock).sections);
+
+    config                                    = base;
+    config.recording.rotation.keyframeAligned = !base.recording.rotation.keyframeAligned;
+    config.recording.baseName                 = "z";
+    EXPECT(config.diff(base).sections == changesOf(ConfigSection::storage, ConfigSection::rotation).sections);
+
+    // A change in the last record of the last section.
+    auto withRule = base;
+
+    withRule.recording.rules.push_back({0, 5, RecurrenceKind::daily, 0, 0});
+    config                                 = withRule;
+    config.recording.rules.back().duration = 6;
+    EXPECT(config.diff(withRule).sections == changesOf(ConfigSection::schedule).sections);
+    EXPECT(withRule.diff(withRule).empty());
+
+    testScheduleCap();
+
+    return TestUtil::finish();
+}
@@ -0,0 +1,108 @@
+#include "TestUtil.hpp"
+
+#include "ConfigStore.hpp"
+#include "Resources.hpp"
+#include "TlvWriter.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <span>
+#include <vector>
+
+#include <FlashMemory.h>
+
+namespace {
+    using Values = std::map<uint8_t, uint32_t>;
+
+    constexpr size_t recordCount    = 20;
+    constexpr int generationCount   = 150;
+    constexpr size_t trialCount     = 5000;
+    constexpr size_t maxFlippedBits = 4;
+    constexpr size_t storeSize      = configStoreSectorCount * flashMemoryMappedSize;
+
+    Values expected(int generation) {
+        Values result;
+
+        for (size_t i = 0; i < recordCount; i++) {
+            result[static_cast<uint8_t>(1 + i)] = i == generation % recordCount ? generation : i;
+        }
+
+        return result;
+    }
+
+    std::vector<uint8_t> encode(const Values& values) {
+        std::array<uint8_t, 1024> buffer;
+        TlvWriter writer{buffer};
+
+        for (auto&& [type, value] : values) {
+            writer.write(type, value);
+        }
+
+        return {writer.data().begin(), writer.data().end()};
+    }
+
+    Values load() {
+        ConfigStore store{configStoreFlashOffset, configStoreSectorCount};
+        Values result;
+
+        store.begin();
+        store.forEach([&](uint8_t type, std::span<const uint8_t> value) {
+            result[type] = value.size() == 4 ? value[0] << 24 | value[1] << 16 | value[2] << 8 | value[3] : ~0U;
+        });
+
+        return result;
+    }
+} // namespace
+
+// Flips random bits across the whole store. Every record CRC and commit digest has to hold, so that loading yields
+// the latest generation, an older one or nothing, but never a mix of generations or a corrupted value.
+int main() {
+    FlashMemory.begin(FLASH_MEMORY_APP_BASE, flashMemoryMappedSize);
+
+    for (int generation = 0; generation < generationCount; generation++) {
+        ConfigStore store{configStoreFlashOffset, configStoreSectorCount};
+
+        store.begin();
+        store.commit(encode(expected(generation)));
+        store.maintain();
+    }
+
+    const auto intact = FakeFlash::memory();
+    std::mt19937 random{5};
+    size_t latest{};
+    size_t older{};
+    size_t empty{};
+    size_t corrupted{};
+
+    for (size_t trial = 0; trial < trialCount; trial++) {
+        FakeFlash::memory() = intact;
+
+        for (size_t i = 0, count = 1 + random() % maxFlippedBits; i < count; i++) {
+            FakeFlash::memory()[configStoreFlashOffset + random() % storeSize] ^= 1U << (random() % 8);
+        }
+
+        const auto values = load();
+
+        if (values == expected(generationCount - 1)) {
+            latest++;
+        } else if (values.empty()) {
+            empty++;
+        } else {
+            auto found = false;
+
+            for (int generation = 0; generation < generationCount - 1 && !found; generation++) {
+                found = values == expected(generation);
+            }
+
+            found ? older++ : corrupted++;
+        }
+    }
+
+    std::printf("%zu latest, %zu older, %zu empty, %zu corrupted\n", latest, older, empty, corrupted);
+    EXPECT(corrupted == 0);
+
+    return TestUtil::finish();
+}
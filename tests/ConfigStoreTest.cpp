@@ -0,0 +1,142 @@
+#include "TestUtil.hpp"
+
+#include "ConfigStore.hpp"
+#include "Resources.hpp"
+#include "TlvWriter.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <span>
+#include <vector>
+
+#include <FlashMemory.h>
+
+namespace {
+    using Values = std::map<uint8_t, uint32_t>;
+
+    constexpr size_t recordCount      = 20;
+    constexpr int generationCount     = 400;
+    constexpr int powerCutGenerations = 60;
+
+    // Generation `generation` changes one record per commit, so that most commits append instead of compacting.
+    Values expected(int generation, size_t count = recordCount) {
+        Values result;
+
+        for (size_t i = 0; i < count; i++) {
+            result[static_cast<uint8_t>(1 + i)] = i == generation % count ? generation : i;
+        }
+
+        return result;
+    }
+
+    std::vector<uint8_t> encode(const Values& values) {
+        std::array<uint8_t, 1024> buffer;
+        TlvWriter writer{buffer};
+
+        for (auto&& [type, value] : values) {
+            writer.write(type, value);
+        }
+
+        return {writer.data().begin(), writer.data().end()};
+    }
+
+    // Loads the store the way a fresh boot does.
+    Values load() {
+        ConfigStore store{configStoreFlashOffset, configStoreSectorCount};
+        Values result;
+
+        store.begin();
+        store.forEach([&](uint8_t type, std::span<const uint8_t> value) {
+            result[type] = value.size() == 4 ? value[0] << 24 | value[1] << 16 | value[2] << 8 | value[3] : ~0U;
+        });
+
+        return result;
+    }
+
+    bool commit(const Values& values) {
+        ConfigStore store{configStoreFlashOffset, configStoreSectorCount};
+
+        store.begin();
+
+        const auto result = store.commit(encode(values));
+
+        store.maintain();
+
+        return result;
+    }
+
+    int testGenerations() {
+        for (int generation = 0; generation < generationCount; generation++) {
+            EXPECT(commit(expected(generation)));
+
+            if (!EXPECT(load() == expected(generation))) {
+                return generation;
+            }
+        }
+
+        std::printf("%d generations: %zu erases, %zu words programmed\n", generationCount, FakeFlash::eraseCount(),
+            FakeFlash::programmedWords());
+
+        // Fewer records remove the dropped types.
+        EXPECT(commit(expected(generationCount, 5)));
+        EXPECT(load() == expected(generationCount, 5));
+
+        return generationCount + 1;
+    }
+
+    // Cuts the power at every word a commit and the following maintenance program. The store must come back with
+    // either generation, and keep accepting commits afterwards.
+    void testPowerCuts(int firstGeneration) {
+        size_t trials{};
+
+        for (auto generation = firstGeneration; generation < firstGeneration + powerCutGenerations; generation++) {
+            const auto before   = FakeFlash::memory();
+            const auto previous = load();
+            const auto next     = expected(generation);
+
+            for (long words = 0;; words++) {
+                bool finished{};
+
+                FakeFlash::memory() = before;
+                FakeFlash::cutPowerAfter(words);
+
+                try {
+                    commit(next);
+                    finished = true;
+                } catch (const FakeFlash::PowerLoss&) {
+                }
+
+                FakeFlash::cutPowerAfter(-1);
+                trials++;
+
+                const auto recovered = load();
+
+                EXPECT(recovered == previous || recovered == next);
+
+                const auto later = expected(generation + 1000);
+
+                EXPECT(commit(later));
+                EXPECT(load() == later);
+
+                if (finished) {
+                    break;
+                }
+            }
+
+            FakeFlash::memory() = before;
+            commit(next);
+        }
+
+        std::printf("%zu power cuts recovered\n", trials);
+    }
+} // namespace
+
+int main() {
+    FlashMemory.begin(FLASH_MEMORY_APP_BASE, flashMemoryMappedSize);
+
+    testPowerCuts(testGenerations());
+
+    return TestUtil::finish();
+}
@@ -0,0 +1,111 @@
+#include "TestUtil.hpp"
+
+#include "DS3231.hpp"
+#include "TimeUtil.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <Wire.h>
+
+namespace {
+    constexpr uint8_t deviceAddress  = 0x68;
+    constexpr uint8_t controlReg     = 0x0E;
+    constexpr uint8_t statusReg      = 0x0F;
+    // Oscillator stop, 32 kHz output, Alarm 2 and Alarm 1 flags; only the flags are cleared by writing 0.
+    constexpr uint8_t initialStatus  = 0x8B;
+    constexpr uint8_t statusFlags    = 0x83;
+    // Rate select and INTCN set, as after power-up.
+    constexpr uint8_t initialControl = 0x1C;
+
+    bool wrote(const TwoWire::Transaction& transaction, std::vector<uint8_t> bytes) {
+        return transaction.address == deviceAddress && transaction.bytes == bytes;
+    }
+
+    void testDateTime(TwoWire& wire, DS3231& rtc) {
+        wire.writes.clear();
+        rtc.setDateTime({2024, 2, 29, 23, 59, 58});
+
+        EXPECT(wire.writes.size() == 1);
+        EXPECT(wrote(wire.writes.back(), {0x00, 0x58, 0x59, 0x23, 0x01, 0x29, 0x02, 0x24}));
+
+        const auto dateTime = rtc.getDateTime();
+
+        EXPECT(dateTime.year == 2024);
+        EXPECT(dateTime.month == 2);
+        EXPECT(dateTime.day == 29);
+        EXPECT(dateTime.hour == 23);
+        EXPECT(dateTime.minute == 59);
+        EXPECT(dateTime.second == 58);
+    }
+
+    // The wake alarm is built from a Unix timestamp, as the recording controller does, a few seconds before a window
+    // that opens at midnight, so the alarm lands on the previous day.
+    void testArmAlarm1(TwoWire& wire, DS3231& rtc) {
+        constexpr int64_t windowStart = 1709251200; // 2024-03-01T00:00:00Z
+        constexpr int64_t leadSec     = 3;
+
+        wire.writes.clear();
+        rtc.enableSquareWave(true);
+
+        EXPECT(wire.writes.size() == 1);
+        EXPECT(wrote(wire.writes.back(), {controlReg, 0x00}));
+
+        const auto reads = wire.reads;
+
+        wire.writes.clear();
+        rtc.armAlarm1(TimeUtil::toDateTime(windowStart - leadSec));
+
+        // One burst from the alarm registers to the status register, without reading anything back. Alarm 2 keeps
+        // its registers, the control register enables INTCN and A1IE, and only the Alarm 1 flag is written as 0.
+        EXPECT(wire.reads == reads);
+        EXPECT(wire.writes.size() == 1);
+        EXPECT(wrote(wire.writes.back(), {0x07, 0x57, 0x59, 0x23, 0x29, 0x12, 0x34, 0x05, 0x05, 0x8A}));
+
+        EXPECT(wire.registers[controlReg] == 0x05);
+        EXPECT(wire.registers[statusReg] == (initialStatus & ~0x01));
+    }
+
+    void testAlarmFlags(TwoWire& wire, DS3231& rtc) {
+        wire.registers[statusReg] |= 0x01;
+        EXPECT(rtc.alarm1Triggered());
+        EXPECT(rtc.alarm2Triggered());
+
+        wire.writes.clear();
+        rtc.clearAlarm1Flag();
+
+        EXPECT(wire.writes.size() == 1);
+        EXPECT(wrote(wire.writes.back(), {statusReg, 0x8A}));
+        EXPECT(!rtc.alarm1Triggered());
+        EXPECT(rtc.alarm2Triggered());
+        EXPECT(wire.registers[statusReg] == (initialStatus & ~0x01));
+
+        // Back to the square wave, with the alarm interrupt still enabled for the next arm.
+        wire.writes.clear();
+        rtc.enableSquareWave(true);
+
+        EXPECT(wrote(wire.writes.back(), {controlReg, 0x01}));
+    }
+} // namespace
+
+int main() {
+    auto&& wire = Wire;
+
+    wire.registers[0x0B]       = 0x12;
+    wire.registers[0x0C]       = 0x34;
+    wire.registers[0x0D]       = 0x05;
+    wire.registers[controlReg] = initialControl;
+    wire.registers[statusReg]  = initialStatus;
+    wire.clearOnly[statusReg]  = statusFlags;
+
+    DS3231 rtc{wire};
+
+    rtc.begin();
+
+    testDateTime(wire, rtc);
+    testArmAlarm1(wire, rtc);
+    testAlarmFlags(wire, rtc);
+
+    return TestUtil::finish();
+}
@@ -0,0 +1,83 @@
+#include "TestUtil.hpp"
+
+#include "HashUtil.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <span>
+#include <vector>
+
+namespace {
+    constexpr size_t randomCases    = 2000;
+    constexpr size_t benchmarkBytes = 16 * 1024 * 1024;
+
+    // The textbook bit-at-a-time CRC-32 the table-driven one must agree with.
+    uint32_t referenceCrc32(std::span<const uint8_t> data) {
+        uint32_t crc = ~0U;
+
+        for (auto byte : data) {
+            crc ^= byte;
+
+            for (size_t bit = 0; bit < 8; bit++) {
+                crc = (crc >> 1) ^ (0xEDB88320 & (0U - (crc & 1)));
+            }
+        }
+
+        return ~crc;
+    }
+
+    template <typename Function>
+    double toMegabytesPerSecond(Function&& function) {
+        const auto start = std::chrono::steady_clock::now();
+
+        function();
+
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        return benchmarkBytes / elapsed.count() / (1024 * 1024);
+    }
+} // namespace
+
+int main() {
+    constexpr uint8_t checkInput[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    std::mt19937 random{1};
+
+    EXPECT(HashUtil::crc32(checkInput) == 0xCBF43926);
+    EXPECT(HashUtil::crc32({}) == 0);
+
+    // Random lengths cover every alignment and tail, and a random split checks that the CRC continues.
+    for (size_t i = 0; i < randomCases; i++) {
+        std::vector<uint8_t> data(random() % 300);
+
+        for (auto&& byte : data) {
+            byte = static_cast<uint8_t>(random());
+        }
+
+        const std::span<const uint8_t> bytes{data};
+        const auto split = data.empty() ? 0 : random() % data.size();
+
+        EXPECT(HashUtil::crc32(bytes) == referenceCrc32(bytes));
+        EXPECT(HashUtil::crc32(bytes.subspan(split), HashUtil::crc32(bytes.first(split))) == referenceCrc32(bytes));
+    }
+
+    // Any single flipped bit changes the CRC.
+    std::vector<uint8_t> record(64, 0x5A);
+    const auto crc = HashUtil::crc32(record);
+
+    for (size_t bit = 0; bit < record.size() * 8; bit++) {
+        record[bit / 8] ^= 1U << (bit % 8);
+        EXPECT(HashUtil::crc32(record) != crc);
+        record[bit / 8] ^= 1U << (bit % 8);
+    }
+
+    const std::vector<uint8_t> large(benchmarkBytes, 7);
+    volatile uint32_t sink{};
+    const auto tableSpeed     = toMegabytesPerSecond([&] { sink = HashUtil::crc32(large); });
+    const auto referenceSpeed = toMegabytesPerSecond([&] { sink = referenceCrc32(large); });
+
+    std::printf("CRC-32: %.0f MB/s, bitwise reference %.0f MB/s\n", tableSpeed, referenceSpeed);
+
+    return TestUtil::finish();
+}
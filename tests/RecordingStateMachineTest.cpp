@@ -0,0 +1,106 @@
+#include "TestUtil.hpp"
+
+#include "AppConfig.hpp"
+#include "RecordingStateMachine.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <vector>
+
+namespace {
+    constexpr size_t planCount         = 4000;
+    constexpr size_t ruleCount         = 1000;
+    constexpr int64_t scheduleStart    = 1704067200; // 2024-01-01T00:00:00Z
+    constexpr int64_t planSpacingSec   = 15 * 60;
+    constexpr uint32_t planDurationSec = 5 * 60;
+    constexpr uint32_t ruleDurationSec = 30;
+    constexpr int64_t halfWindowSec    = 12 * 60 * 60;
+    constexpr size_t rebuildCount      = 100;
+    constexpr size_t transitionQueries = 200000;
+    constexpr int64_t queryIntervalSec = halfWindowSec + 1;
+
+    using Clock = std::chrono::steady_clock;
+
+    // A plan every 15 minutes for 41 days, and rules of every kind anchored over the week before, so each of them
+    // occurs once or twice a day.
+    void createSchedule(std::vector<AppConfig::RecordingPlan>& plans, std::vector<AppConfig::RecurringRule>& rules) {
+        for (size_t i = 0; i < planCount; i++) {
+            plans.push_back({scheduleStart + static_cast<int64_t>(i) * planSpacingSec, planDurationSec});
+        }
+
+        for (size_t i = 0; i < ruleCount; i++) {
+            const auto anchor   = scheduleStart - 7 * 24 * 60 * 60 + static_cast<int64_t>(i) * 601;
+            const auto kind     = static_cast<RecurrenceKind>(i % 3);
+            const auto interval = static_cast<uint16_t>(12 + i % 12);
+
+            rules.push_back({anchor, ruleDurationSec, kind, static_cast<uint8_t>(0x3E), interval});
+        }
+    }
+
+    double toUsPerOp(Clock::duration duration, size_t count) {
+        return std::chrono::duration<double, std::micro>(duration).count() / count;
+    }
+} // namespace
+
+// Benchmarks the two costs the controller pays with a large schedule: rebuilding the expanded window every 12 hours,
+// and asking for the next transition on every loop in between.
+int main() {
+    std::vector<AppConfig::RecordingPlan> plans;
+    std::vector<AppConfig::RecurringRule> rules;
+    RecordingStateMachine stateMachine;
+
+    createSchedule(plans, rules);
+
+    const auto updateStart = Clock::now();
+
+    stateMachine.update(plans, rules);
+
+    // Every query lands past the middle of the previous window, so each one rebuilds.
+    const auto rebuildStart = Clock::now();
+
+    for (size_t i = 0; i < rebuildCount; i++) {
+        const auto timestamp = scheduleStart + static_cast<int64_t>(i) * queryIntervalSec;
+
+        EXPECT(stateMachine.nextTransition(timestamp) > timestamp);
+    }
+
+    // The same window answers every query, so this is the cost of the lookups alone.
+    const auto transitionStart = Clock::now();
+    const auto windowStart     = scheduleStart + static_cast<int64_t>(rebuildCount) * queryIntervalSec;
+    size_t failures{};
+
+    stateMachine.nextTransition(windowStart);
+
+    for (size_t i = 0; i < transitionQueries; i++) {
+        const auto timestamp = windowStart + static_cast<int64_t>(i % halfWindowSec);
+        const auto next      = stateMachine.nextTransition(timestamp);
+
+        failures += !next || *next <= timestamp;
+    }
+
+    const auto end = Clock::now();
+
+    EXPECT(failures == 0);
+
+    // Over a real day, the controller sees every plan and rule occurrence start.
+    bool recorded{};
+    size_t starts{};
+
+    stateMachine.update(plans, rules);
+
+    for (std::optional<int64_t> timestamp = scheduleStart; timestamp && *timestamp < scheduleStart + 2 * halfWindowSec;
+         timestamp = stateMachine.nextTransition(*timestamp)) {
+        starts += stateMachine.tryMatch(*timestamp, recorded).has_value();
+    }
+
+    EXPECT(starts > 0);
+
+    std::printf("%zu plans, %zu rules: update %.1f us, rebuild %.1f us, nextTransition %.3f us\n", planCount, ruleCount,
+        toUsPerOp(rebuildStart - updateStart, 1), toUsPerOp(transitionStart - rebuildStart, rebuildCount),
+        toUsPerOp(end - transitionStart, transitionQueries));
+    std::printf("%zu windows started in a day\n", starts);
+
+    return TestUtil::finish();
+}
@@ -0,0 +1,200 @@
+#include "TestUtil.hpp"
+
+#include "AppConfig.hpp"
+#include "RecordingStateMachine.hpp"
+#include "ScheduleProgress.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace {
+    constexpr int64_t hour       = 60 * 60;
+    constexpr int64_t day        = 24 * hour;
+    constexpr int64_t monthStart = 1709251200; // 2024-03-01T00:00:00Z, a Friday
+    constexpr int64_t monthEnd   = monthStart + 31 * day;
+    constexpr int64_t february   = monthStart - 29 * day;
+
+    // The controller also wakes up between transitions; an odd period lands on every hour of the day over the month,
+    // in and out of windows and on both sides of the 12 hour rebuilds.
+    constexpr int64_t pollPeriodSec = 7 * hour + 13 * 60;
+    constexpr size_t rebootEvery    = 3;
+
+    struct Window {
+        int64_t start{};
+        int64_t end{};
+
+        bool operator==(const Window&) const = default;
+    };
+
+    using Plans = std::vector<AppConfig::RecordingPlan>;
+    using Rules = std::vector<AppConfig::RecurringRule>;
+
+    // Overlapping plans, a plan that ends where the daily rule starts, one across midnight and one longer than the
+    // expanded window.
+    Plans createPlans() {
+        return {
+            {monthStart + 2 * day + 10 * hour, 2 * hour},
+            {monthStart + 2 * day + 11 * hour, 3 * hour},
+            {monthStart + 4 * day + 5 * hour, hour},
+            {monthStart + 9 * day + 22 * hour, 4 * hour},
+            {monthStart + 19 * day, 30 * hour},
+        };
+    }
+
+    Rules createRules() {
+        return {
+            {february + 6 * hour, 30 * 60, RecurrenceKind::daily, 0, 0},
+            {february + 12 * hour, hour, RecurrenceKind::weekdays, 0x3E, 0},
+            {february + 20 * hour, 2 * hour, RecurrenceKind::weekdays, 0x41, 0},
+            {monthStart - day + hour, 20 * 60, RecurrenceKind::everyNHours, 0, 5},
+        };
+    }
+
+    uint8_t weekdayOf(int64_t timestamp) {
+        return static_cast<uint8_t>((timestamp / day + 4) % 7);
+    }
+
+    // Expands the schedule by brute force and merges touching windows, independently of the state machine.
+    std::vector<Window> expectedWindows(const Plans& plans, const Rules& rules) {
+        std::vector<Window> occurrences;
+        std::vector<Window> result;
+
+        for (auto&& plan : plans) {
+            occurrences.push_back({plan.startTimestamp, plan.startTimestamp + plan.duration});
+        }
+
+        for (auto&& rule : rules) {
+            const auto period = rule.kind == RecurrenceKind::everyNHours ? rule.intervalHours * hour : day;
+
+            for (auto start = rule.anchorTimestamp; start < monthEnd; start += period) {
+                if (rule.kind != RecurrenceKind::weekdays || (rule.weekdayMask & (1U << weekdayOf(start))) != 0) {
+                    occurrences.push_back({start, start + rule.duration});
+                }
+            }
+        }
+
+        std::ranges::sort(occurrences, {}, &Window::start);
+
+        for (auto&& item : occurrences) {
+            if (!result.empty() && item.start <= result.back().end) {
+                result.back().end = std::max(result.back().end, item.end);
+            } else {
+                result.push_back(item);
+            }
+        }
+
+        std::erase_if(result, [](const Window& item) { return item.end <= monthStart || item.start >= monthEnd; });
+
+        return result;
+    }
+
+    // Follows the clock the way the controller does: to the next transition, or the next poll if that comes first.
+    // Every few polls the device reboots, and the state machine is rebuilt from the saved progress.
+    std::vector<Window> simulate(const Plans& plans, const Rules& rules, size_t& reboots) {
+        auto stateMachine = std::make_unique<RecordingStateMachine>();
+        std::vector<Window> result;
+        std::optional<int64_t> sessionStart;
+        size_t polls{};
+
+        stateMachine->update(plans, rules);
+
+        for (auto timestamp = monthStart; timestamp < monthEnd;) {
+            bool recorded{};
+
+            if (const auto plan = stateMachine->tryMatch(timestamp, recorded)) {
+                EXPECT(!sessionStart);
+                EXPECT(plan->startTimestamp == timestamp);
+                sessionStart.emplace(timestamp);
+            }
+
+            if (recorded) {
+                EXPECT(sessionStart);
+            } else if (sessionStart) {
+                result.push_back({*sessionStart, timestamp});
+                sessionStart.reset();
+            }
+
+            const auto transition = stateMachine->nextTransition(timestamp);
+            const auto poll       = timestamp + pollPeriodSec - timestamp % pollPeriodSec;
+
+            EXPECT(!transition || *transition > timestamp);
+
+            if (!transition || poll < *transition) {
+                timestamp = poll;
+
+                if (++polls % rebootEvery == 0) {
+                    ScheduleProgress progress;
+
+                    stateMachine->saveProgress(progress);
+                    stateMachine = std::make_unique<RecordingStateMachine>();
+                    stateMachine->update(plans, rules);
+                    EXPECT(stateMachine->restoreProgress(progress));
+                    reboots++;
+                }
+            } else {
+                timestamp = *transition;
+            }
+        }
+
+        if (sessionStart) {
+            result.push_back({*sessionStart, monthEnd});
+        }
+
+        return result;
+    }
+
+    void testProgressIsTiedToTheSchedule(const Plans& plans, Rules rules) {
+        RecordingStateMachine stateMachine;
+        ScheduleProgress progress;
+        bool recorded{};
+
+        stateMachine.update(plans, rules);
+        EXPECT(stateMachine.tryMatch(monthStart + 6 * hour, recorded));
+        stateMachine.saveProgress(progress);
+
+        // The same window is not started again after the reboot.
+        RecordingStateMachine restored;
+
+        restored.update(plans, rules);
+        EXPECT(restored.restoreProgress(progress));
+        EXPECT(!restored.tryMatch(monthStart + 6 * hour + 60, recorded));
+        EXPECT(recorded);
+
+        // A changed rule makes the snapshot meaningless.
+        RecordingStateMachine changed;
+
+        rules.front().duration++;
+        changed.update(plans, rules);
+        EXPECT(!changed.restoreProgress(progress));
+    }
+} // namespace
+
+// Runs a month of schedule on a simulated clock and checks that every window starts and stops exactly once, at its
+// exact boundaries, also when the device reboots in the middle of one.
+int main() {
+    const auto plans    = createPlans();
+    const auto rules    = createRules();
+    const auto expected = expectedWindows(plans, rules);
+    size_t reboots{};
+    const auto actual   = simulate(plans, rules, reboots);
+
+    EXPECT(actual.size() == expected.size());
+
+    for (size_t i = 0; i < std::min(actual.size(), expected.size()); i++) {
+        if (!EXPECT(actual[i] == expected[i])) {
+            std::fprintf(stderr, "window %zu: [%lld, %lld) instead of [%lld, %lld)\n", i,
+                static_cast<long long>(actual[i].start), static_cast<long long>(actual[i].end),
+                static_cast<long long>(expected[i].start), static_cast<long long>(expected[i].end));
+        }
+    }
+
+    testProgressIsTiedToTheSchedule(plans, rules);
+
+    std::printf("%zu windows over the month, %zu reboots\n", actual.size(), reboots);
+
+    return TestUtil::finish();
+}
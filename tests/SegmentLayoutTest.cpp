@@ -0,0 +1,112 @@
+#include "TestUtil.hpp"
+
+#include "CommonTypes.hpp"
+#include "StorageUtil.hpp"
+#include "TimeUtil.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+
+#include <AmebaFatFS.h>
+#include <ff.h>
+
+namespace {
+    constexpr int64_t sessionStart      = 1709251200; // 2024-03-01T00:00:00Z
+    constexpr int64_t segmentSec        = 30 * 60;
+    constexpr size_t segmentsPerDay     = 24 * 60 * 60 / segmentSec;
+    constexpr std::array checkpoints    = {1, 7, 30, 90};
+    constexpr size_t dayCount           = checkpoints.back();
+    constexpr const char* layoutNames[] = {"flat", "daily", "hourly"};
+
+    struct Cost {
+        double reads{};
+        double writes{};
+    };
+
+    // Creates one day of segments the way MixingStreamer names and places them, and returns the mean sector
+    // transfers of one, the directory included when a new one starts.
+    Cost recordDay(AmebaFatFS& fs, DirectoryLayout layout, size_t day, String& directory) {
+        const auto reads  = FakeFat::sectorReads();
+        const auto writes = FakeFat::sectorWrites();
+        const auto start  = TimeUtil::toDateTime(sessionStart);
+
+        for (size_t i = 0; i < segmentsPerDay; i++) {
+            const auto index     = day * segmentsPerDay + i;
+            const auto timestamp = sessionStart + static_cast<int64_t>(index) * segmentSec;
+
+            if (auto next = StorageUtil::toSegmentDirectory(layout, TimeUtil::toDateTime(timestamp));
+                next != directory || index == 0) {
+                EXPECT(StorageUtil::createDirectories(fs, next));
+                directory = std::move(next);
+            }
+
+            char path[160];
+            FIL file;
+
+            std::snprintf(path, sizeof(path), "%s%s%srecording_%04u-%02u-%02uT%02u-%02u-%02u_%zu.mp4",
+                fs.getRootPath(), directory.c_str(), directory.length() != 0 ? "/" : "", start.year, start.month,
+                start.day, start.hour, start.minute, start.second, index);
+
+            if (EXPECT(f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK)) {
+                f_close(&file);
+            }
+        }
+
+        return {static_cast<double>(FakeFat::sectorReads() - reads) / segmentsPerDay,
+            static_cast<double>(FakeFat::sectorWrites() - writes) / segmentsPerDay};
+    }
+} // namespace
+
+// Compares the cost of creating a segment as the card fills up, for a 30 minute rotation over 90 days. The host has
+// no card to time, so the cost is counted in sector transfers through the FatFs model, each of which is one SD
+// command on the device.
+int main() {
+    std::array<std::array<Cost, checkpoints.size()>, std::size(layoutNames)> costs{};
+
+    std::printf("Sector reads/writes per segment on day");
+
+    for (auto day : checkpoints) {
+        std::printf(" %12d", day);
+    }
+
+    std::printf("\n");
+
+    for (size_t layout = 0; layout < std::size(layoutNames); layout++) {
+        AmebaFatFS fs;
+        String directory;
+        size_t checkpoint{};
+
+        fs.begin();
+
+        for (size_t day = 0; day < dayCount; day++) {
+            const auto cost = recordDay(fs, static_cast<DirectoryLayout>(layout), day, directory);
+
+            if (day + 1 == static_cast<size_t>(checkpoints[checkpoint])) {
+                costs[layout][checkpoint++] = cost;
+            }
+        }
+
+        std::printf("%-38s", layoutNames[layout]);
+
+        for (auto&& cost : costs[layout]) {
+            std::printf(" %7.1f/%4.1f", cost.reads, cost.writes);
+        }
+
+        std::printf("\n");
+    }
+
+    auto&& flat   = costs[static_cast<size_t>(DirectoryLayout::flat)];
+    auto&& daily  = costs[static_cast<size_t>(DirectoryLayout::daily)];
+    auto&& hourly = costs[static_cast<size_t>(DirectoryLayout::hourly)];
+
+    // A flat directory costs more with every segment. A sharded one only grows with the root, which gains one
+    // directory a day; hourly shards pay for clearing a new directory cluster every other segment instead.
+    EXPECT(flat.back().reads > 20 * flat.front().reads);
+    EXPECT(daily.back().reads < 2 * daily.front().reads);
+    EXPECT(daily.back().reads * 20 < flat.back().reads);
+    EXPECT(hourly.back().reads * 20 < flat.back().reads);
+    EXPECT(hourly.back().writes > 10 * daily.back().writes);
+
+    return TestUtil::finish();
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdio>
+
+// Records a failed expectation and carries on, so that one run lists every failure.
+#define EXPECT(condition) TestUtil::expect(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
+
+namespace TestUtil {
+    inline int failures{};
+
+    inline bool expect(bool passed, const char* expression, const char* file, int line) {
+        if (!passed) {
+            std::fprintf(stderr, "%s:%d: expected `%s`\n", file, line, expression);
+            failures++;
+        }
+
+        return passed;
+    }
+
+    // The exit code of the test.
+    inline int finish() {
+        if (failures != 0) {
+            std::fprintf(stderr, "%d expectation(s) failed.\n", failures);
+        }
+
+        return failures == 0 ? 0 : 1;
+    }
+} // namespace TestUtil
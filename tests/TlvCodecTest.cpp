@@ -0,0 +1,578 @@
+#include "TestUtil.hpp"
+
+#include "AppConfig.hpp"
+#include "BinaryUtil.hpp"
+#include "BtpConstants.hpp"
+#include "ProtocolSchema.hpp"
+#include "TlvConstants.hpp"
+#include "TlvParser.hpp"
+#include "TlvWriter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace {
+    size_t allocations{};
+}
+
+// Counts every allocation of the test, so that the decoders can be checked for the ones they make.
+void* operator new(size_t size) {
+    allocations++;
+
+    if (const auto result = std::malloc(size != 0 ? size : 1)) {
+        return result;
+    }
+
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+// The hand-written decoder the schema replaced, kept as the baseline of the benchmark. A handler per record type is
+// registered in a map for every message, and the message is copied through a read handler in chunks. The inline
+// validation is left out, `sanitize` does that now.
+namespace Legacy {
+    template <typename... Ts>
+    struct overloaded : Ts... {
+        using Ts::operator()...;
+    };
+
+    class TlvReader {
+    public:
+        using ReadHandler = std::function<size_t(uint8_t* data, size_t size)>;
+
+        template <typename T>
+        using DataHandler = std::function<void(uint8_t type, T value)>;
+
+        using DataHandlerVariant = std::variant<DataHandler<uint8_t>, DataHandler<uint16_t>, DataHandler<uint32_t>,
+            DataHandler<uint64_t>, DataHandler<String>>;
+
+        explicit TlvReader(std::span<const uint8_t> buffer) {
+            size_t offset{};
+
+            readHandler_ = [buffer, offset](uint8_t* data, size_t size) mutable -> size_t {
+                const auto bytesToRead = std::min(size, buffer.size() - offset);
+
+                std::ranges::copy(buffer.subspan(offset, bytesToRead), data);
+                offset += bytesToRead;
+
+                return bytesToRead;
+            };
+        }
+
+        void registerHandler(uint8_t type, DataHandlerVariant handler) {
+            typeMapping_.insert_or_assign(type, std::move(handler));
+        }
+
+        bool readAll() const {
+            static constexpr size_t bufferSize = 1024;
+
+            std::array<uint8_t, bufferSize> buffer{};
+            size_t bytesRead{};
+            size_t offset{};
+
+            if (readHandler_(buffer.data(), TlvConstants::magic.size()) != TlvConstants::magic.size()
+                || !std::equal(TlvConstants::magic.begin(), TlvConstants::magic.end(), buffer.begin())) {
+                return false;
+            }
+
+            while ((bytesRead = readHandler_(buffer.data() + offset, bufferSize - offset)) != 0) {
+                offset += bytesRead;
+
+                size_t parseOffset{};
+
+                while (parseOffset + TlvConstants::typeLengthSize <= offset) {
+                    const auto type   = buffer[parseOffset];
+                    const auto length = buffer[parseOffset + 1];
+
+                    if (parseOffset + TlvConstants::typeLengthSize + length > offset) {
+                        break;
+                    }
+
+                    if (const auto iter = typeMapping_.find(type); iter != typeMapping_.end()) {
+                        dispatchValue(type, {buffer.data() + parseOffset + TlvConstants::typeLengthSize, length},
+                            iter->second);
+                    }
+
+                    parseOffset += TlvConstants::typeLengthSize + length;
+                }
+
+                std::ranges::copy(buffer.data() + parseOffset, buffer.data() + offset, buffer.data());
+                offset -= parseOffset;
+            }
+
+            return true;
+        }
+
+    private:
+        static void dispatchValue(uint8_t type, std::span<const uint8_t> rawValue, const DataHandlerVariant& variant) {
+            if (rawValue.empty()) {
+                return;
+            }
+
+            auto createHandler = [&]<typename T>(std::type_identity<T>, auto&& read) {
+                return [&](const DataHandler<T>& handler) {
+                    if (rawValue.size() == sizeof(T)) {
+                        handler(type, read(rawValue));
+                    }
+                };
+            };
+
+            std::visit(overloaded{
+                           createHandler(std::type_identity<uint8_t>{}, [](auto value) { return value[0]; }),
+                           createHandler(std::type_identity<uint16_t>{}, &BinaryUtil::readU16Be),
+                           createHandler(std::type_identity<uint32_t>{}, &BinaryUtil::readU32Be),
+                           createHandler(std::type_identity<uint64_t>{}, &BinaryUtil::readU64Be),
+                           [&](const DataHandler<String>& handler) {
+                               handler(type, std::string{rawValue.begin(), rawValue.end()}.c_str());
+                           },
+                       },
+                variant);
+        }
+
+        ReadHandler readHandler_;
+        std::unordered_map<uint8_t, DataHandlerVariant> typeMapping_;
+    };
+
+    bool decode(std::span<const uint8_t> buffer, AppConfig& config) {
+        using U8  = TlvReader::DataHandler<uint8_t>;
+        using U32 = TlvReader::DataHandler<uint32_t>;
+        using U64 = TlvReader::DataHandler<uint64_t>;
+        using Str = TlvReader::DataHandler<String>;
+
+        TlvReader reader{buffer};
+        auto&& recording = config.recording;
+
+        reader.registerHandler(1, U8{[&](uint8_t, uint8_t value) { config.hotspot.enabled = value != 0; }});
+        reader.registerHandler(2, Str{[&](uint8_t, String value) { config.hotspot.ssid = std::move(value); }});
+        reader.registerHandler(3, Str{[&](uint8_t, String value) { config.hotspot.password = std::move(value); }});
+        reader.registerHandler(4, Str{[&](uint8_t, String value) { recording.baseName = std::move(value); }});
+        reader.registerHandler(5, U32{[&](uint8_t, uint32_t value) { recording.singleFileDuration = value; }});
+        reader.registerHandler(6, U8{[&](uint8_t, uint8_t value) {
+            recording.directoryLayout = static_cast<DirectoryLayout>(value);
+        }});
+        reader.registerHandler(7, U32{[&](uint8_t, uint32_t value) { recording.minFreeSpaceMb = value; }});
+        reader.registerHandler(8, U32{[&](uint8_t, uint32_t value) { recording.rotation.maxSegmentSizeMb = value; }});
+        reader.registerHandler(9, U32{[&](uint8_t, uint32_t value) { recording.rotation.alignmentSec = value; }});
+        reader.registerHandler(10, U8{[&](uint8_t, uint8_t value) {
+            recording.rotation.keyframeAligned = value != 0;
+        }});
+        reader.registerHandler(11, U32{[&](uint8_t, uint32_t value) { config.clock.resyncSec = value; }});
+
+        for (size_t i = 0; i < 8; i++) {
+            reader.registerHandler(static_cast<uint8_t>(100 + i * 2), U64{[&, i](uint8_t, uint64_t value) {
+                recording.schedule.resize(i + 1);
+                recording.schedule[i].startTimestamp = static_cast<int64_t>(value);
+            }});
+            reader.registerHandler(static_cast<uint8_t>(101 + i * 2), U32{[&, i](uint8_t, uint32_t value) {
+                recording.schedule.resize(i + 1);
+                recording.schedule[i].duration = value;
+            }});
+        }
+
+        for (size_t i = 0; i < 8; i++) {
+            reader.registerHandler(static_cast<uint8_t>(150 + i * 3), U64{[&, i](uint8_t, uint64_t value) {
+                recording.rules.resize(std::max(recording.rules.size(), i + 1));
+                recording.rules[i].anchorTimestamp = static_cast<int64_t>(value);
+            }});
+            reader.registerHandler(static_cast<uint8_t>(151 + i * 3), U32{[&, i](uint8_t, uint32_t value) {
+                recording.rules.resize(std::max(recording.rules.size(), i + 1));
+                recording.rules[i].duration = value;
+            }});
+            reader.registerHandler(static_cast<uint8_t>(152 + i * 3), U32{[&, i](uint8_t, uint32_t value) {
+                recording.rules.resize(std::max(recording.rules.size(), i + 1));
+
+                auto&& rule = recording.rules[i];
+
+                rule.kind          = static_cast<RecurrenceKind>(value & 0xFF);
+                rule.weekdayMask   = static_cast<uint8_t>(value >> 8);
+                rule.intervalHours = static_cast<uint16_t>(value >> 16);
+            }});
+        }
+
+        return reader.readAll();
+    }
+} // namespace Legacy
+
+namespace {
+    constexpr size_t benchmarkIterations = 100000;
+
+    template <typename Function>
+    size_t countAllocations(Function&& function) {
+        const auto before = allocations;
+
+        function();
+
+        return allocations - before;
+    }
+
+    AppConfig createFullConfig() {
+        AppConfig config;
+
+        config.hotspot   = {true, "AMB82-MINI", "12345678"};
+        config.recording = {"recording", 1800, DirectoryLayout::hourly, 512, {64, 600, true}, {}, {}};
+        config.clock     = {600};
+
+        for (uint32_t i = 0; i < 8; i++) {
+            config.recording.schedule.push_back({1700000000 + i * 3600, 600 + i});
+            config.recording.rules.push_back(
+                {1700000000 + i * 60, 60 + i, RecurrenceKind::everyNHours, static_cast<uint8_t>(0x41 + i), 65535});
+        }
+
+        return config;
+    }
+
+    std::vector<uint8_t> encode(const AppConfig& config) {
+        TlvWriter sizer;
+
+        Protocol::AppConfigSchema::encode(config, sizer);
+
+        std::vector<uint8_t> buffer(sizer.size());
+        TlvWriter writer{buffer};
+
+        Protocol::AppConfigSchema::encode(config, writer);
+        EXPECT(!writer.overflowed());
+        EXPECT(writer.data().size() == buffer.size());
+
+        return buffer;
+    }
+
+    void testAppConfigRoundTrip() {
+        const auto config  = createFullConfig();
+        const auto message = encode(config);
+        AppConfig decoded;
+
+        EXPECT(Protocol::AppConfigSchema::decode(message, decoded));
+        EXPECT(decoded.hotspot.enabled);
+        EXPECT(decoded.hotspot.ssid == config.hotspot.ssid);
+        EXPECT(decoded.hotspot.password == config.hotspot.password);
+        EXPECT(decoded.recording.baseName == config.recording.baseName);
+        EXPECT(decoded.recording.singleFileDuration == config.recording.singleFileDuration);
+        EXPECT(decoded.recording.directoryLayout == config.recording.directoryLayout);
+        EXPECT(decoded.recording.minFreeSpaceMb == config.recording.minFreeSpaceMb);
+        EXPECT(decoded.recording.rotation.maxSegmentSizeMb == config.recording.rotation.maxSegmentSizeMb);
+        EXPECT(decoded.recording.rotation.alignmentSec == config.recording.rotation.alignmentSec);
+        EXPECT(decoded.recording.rotation.keyframeAligned);
+        EXPECT(decoded.clock.resyncSec == config.clock.resyncSec);
+        EXPECT(decoded.recording.schedule.size() == config.recording.schedule.size());
+        EXPECT(decoded.recording.rules.size() == config.recording.rules.size());
+
+        for (size_t i = 0; i < std::min(decoded.recording.schedule.size(), config.recording.schedule.size()); i++) {
+            EXPECT(decoded.recording.schedule[i].startTimestamp == config.recording.schedule[i].startTimestamp);
+            EXPECT(decoded.recording.schedule[i].duration == config.recording.schedule[i].duration);
+        }
+
+        for (size_t i = 0; i < std::min(decoded.recording.rules.size(), config.recording.rules.size()); i++) {
+            auto&& expected = config.recording.rules[i];
+            auto&& actual   = decoded.recording.rules[i];
+
+            EXPECT(actual.anchorTimestamp == expected.anchorTimestamp);
+            EXPECT(actual.duration == expected.duration);
+            EXPECT(actual.kind == expected.kind);
+            EXPECT(actual.weekdayMask == expected.weekdayMask);
+            EXPECT(actual.intervalHours == expected.intervalHours);
+        }
+
+        // Short messages keep the version 1 magic, so older readers still parse them.
+        EXPECT(std::equal(TlvConstants::magic.begin(), TlvConstants::magic.end(), message.begin()));
+    }
+
+    void testSystemInfoFitsOneTransfer() {
+        Protocol::SystemInfo info;
+
+        info.sdFreeBytes         = 123456789012ULL;
+        info.lastSegmentBytes    = 0xFFFFFFFFFFULL;
+        info.latencyHistogram[0] = 5;
+        info.latencyHistogram[9] = 77;
+
+        std::array<uint8_t, 230> buffer{};
+        TlvWriter writer{buffer};
+
+        Protocol::SystemInfoSchema::encode(info, writer);
+        EXPECT(!writer.overflowed());
+
+        Protocol::SystemInfo decoded;
+
+        EXPECT(Protocol::SystemInfoSchema::decode(writer.data(), decoded));
+        EXPECT(decoded.sdFreeBytes == info.sdFreeBytes);
+        EXPECT(decoded.lastSegmentBytes == info.lastSegmentBytes);
+        EXPECT(decoded.latencyHistogram == info.latencyHistogram);
+    }
+
+    // The longest strings and the largest values, with `plans` plans and the remaining entries as rules.
+    AppConfig createWorstCaseConfig(size_t plans) {
+        AppConfig config;
+
+        config.hotspot   = {true, "AMB82-MINI-X", "12345678"};
+        config.recording = {"recording-xx", UINT32_MAX, DirectoryLayout::hourly, UINT32_MAX,
+            {UINT32_MAX, UINT32_MAX, true}, {}, {}};
+        config.clock     = {UINT32_MAX};
+
+        for (size_t i = 0; i < AppConfig::maxScheduleEntries; i++) {
+            if (i < plans) {
+                config.recording.schedule.push_back({INT64_MAX, UINT32_MAX});
+            } else {
+                config.recording.rules.push_back(
+                    {INT64_MAX, UINT32_MAX, RecurrenceKind::everyNHours, UINT8_MAX, UINT16_MAX});
+            }
+        }
+
+        return config;
+    }
+
+    // The schedule response is the whole configuration, the request only the schedule after the request type byte.
+    void testWorstCaseConfigFitsOneTransfer() {
+        for (size_t plans = 0; plans <= AppConfig::maxScheduleEntries; plans++) {
+            const auto config = createWorstCaseConfig(plans);
+            std::array<uint8_t, Btp::Constants::mtu> buffer{};
+            TlvWriter response{buffer};
+
+            Protocol::AppConfigSchema::encode(config, response);
+            EXPECT(!response.overflowed());
+
+            AppConfig request;
+            TlvWriter requestWriter{std::span{buffer}.first(Btp::Constants::mtu - 1)};
+
+            request.recording.schedule = config.recording.schedule;
+            request.recording.rules    = config.recording.rules;
+            Protocol::AppConfigSchema::encode(request, requestWriter);
+            EXPECT(!requestWriter.overflowed());
+        }
+
+        // The limit is tight: one more rule no longer fits.
+        auto config = createWorstCaseConfig(0);
+        TlvWriter sizer;
+
+        config.recording.rules.push_back(config.recording.rules.back());
+        Protocol::AppConfigSchema::encode(config, sizer);
+        EXPECT(sizer.size() > Btp::Constants::mtu);
+    }
+
+    void testExtendedRecordsInChunks() {
+        std::vector<uint8_t> large(300);
+        std::vector<uint8_t> buffer(1024);
+        TlvWriter writer{buffer};
+
+        for (size_t i = 0; i < large.size(); i++) {
+            large[i] = static_cast<uint8_t>(i);
+        }
+
+        writer.write(1, uint32_t{0xDEADBEEF});
+        EXPECT(writer.data()[TlvConstants::versionOffset] == TlvConstants::baseVersion);
+
+        writer.write(2, std::span<const uint8_t>{large});
+        writer.write(3, uint8_t{7});
+        EXPECT(!writer.overflowed());
+        EXPECT(writer.data()[TlvConstants::versionOffset] == TlvConstants::extendedVersion);
+
+        const auto message = writer.data();
+
+        // Every split of the message yields the same records, whether handed out in place or gathered in scratch.
+        for (size_t chunkSize = 1; chunkSize <= message.size(); chunkSize++) {
+            std::array<uint8_t, 512> scratch;
+            TlvParser parser{scratch};
+            size_t records{};
+            bool matched{true};
+
+            for (size_t offset = 0; offset < message.size(); offset += chunkSize) {
+                EXPECT(parser.feed(message.subspan(offset, std::min(chunkSize, message.size() - offset)),
+                    [&](uint8_t type, std::span<const uint8_t> value) {
+                        records++;
+
+                        if (type == 2) {
+                            matched &= std::ranges::equal(value, large);
+                        }
+                    }));
+            }
+
+            EXPECT(records == 3);
+            EXPECT(matched);
+            EXPECT(parser.complete());
+        }
+
+        // A straddling record that does not fit the scratch is skipped, the rest still parse.
+        std::array<uint8_t, 16> scratch;
+        TlvParser parser{scratch};
+        size_t records{};
+
+        for (size_t offset = 0; offset < message.size(); offset += 5) {
+            parser.feed(message.subspan(offset, std::min<size_t>(5, message.size() - offset)),
+                [&](uint8_t, std::span<const uint8_t>) { records++; });
+        }
+
+        EXPECT(records == 2);
+    }
+
+    void testFixedBuffers() {
+        std::vector<uint8_t> large(300);
+        TlvWriter sizer;
+
+        for (uint8_t i = 0; i < 5; i++) {
+            sizer.write(i, uint32_t{i});
+        }
+
+        sizer.write(9, std::span<const uint8_t>{large});
+        EXPECT(sizer.overflowed());
+
+        std::vector<uint8_t> exact(sizer.size());
+        TlvWriter writer{exact};
+
+        for (uint8_t i = 0; i < 5; i++) {
+            writer.write(i, uint32_t{i});
+        }
+
+        writer.write(9, std::span<const uint8_t>{large});
+        EXPECT(!writer.overflowed());
+        EXPECT(writer.data().size() == exact.size());
+
+        // A buffer that is too small keeps the records that fit whole and reports the overflow.
+        std::array<uint8_t, 30> small;
+        TlvWriter truncated{small};
+        size_t records{};
+
+        for (uint8_t i = 0; i < 5; i++) {
+            truncated.write(i, uint32_t{i});
+        }
+
+        TlvParser parser;
+
+        EXPECT(truncated.overflowed());
+        EXPECT(parser.feed(truncated.data(), [&](uint8_t, std::span<const uint8_t>) { records++; }));
+        EXPECT(parser.complete());
+        EXPECT(records == 3);
+
+        // Values beyond the extended length can never be encoded.
+        std::vector<uint8_t> huge(TlvConstants::maxExtendedLength + 1);
+        TlvWriter tooLong;
+
+        tooLong.write(1, std::span<const uint8_t>{huge});
+        EXPECT(tooLong.overflowed());
+    }
+
+    void testRejectsForeignMessages() {
+        auto badVersion = TlvConstants::magic;
+        auto badMagic   = TlvConstants::magic;
+        AppConfig config;
+
+        badVersion[TlvConstants::versionOffset] = 3;
+        badMagic[0]                             = 'X';
+
+        EXPECT(!Protocol::AppConfigSchema::decode(badVersion, config));
+        EXPECT(!Protocol::AppConfigSchema::decode(badMagic, config));
+        EXPECT(!Protocol::AppConfigSchema::decode(std::span<const uint8_t>{}, config));
+    }
+
+    void testDecodeAllocations() {
+        auto config = createFullConfig();
+        AppConfig decoded;
+
+        // The host String keeps these short values inline. The target String allocates a buffer for each of the three
+        // strings, which is the only allocation left on this path there.
+        config.recording.schedule.clear();
+        config.recording.rules.clear();
+
+        const auto scalars = encode(config);
+
+        EXPECT(countAllocations([&] { EXPECT(Protocol::AppConfigSchema::decode(scalars, decoded)); }) == 0);
+
+        // The schedule and the rules allocate once each, reserved for their maximum count on the first element.
+        const auto full = encode(createFullConfig());
+        AppConfig decodedFull;
+
+        EXPECT(countAllocations([&] { EXPECT(Protocol::AppConfigSchema::decode(full, decodedFull)); }) == 2);
+        EXPECT(decodedFull.recording.schedule.size() == 8);
+        EXPECT(decodedFull.recording.rules.size() == 8);
+
+        // The baseline reads the same messages into the same config.
+        AppConfig legacy;
+
+        EXPECT(Legacy::decode(full, legacy));
+        EXPECT(encode(legacy) == full);
+    }
+
+    void benchmark() {
+        using Clock = std::chrono::steady_clock;
+
+        const auto config = createFullConfig();
+        std::array<uint8_t, 1024> buffer;
+        size_t size{};
+        size_t checksum{};
+
+        const auto encodeStart = Clock::now();
+
+        for (size_t i = 0; i < benchmarkIterations; i++) {
+            TlvWriter writer{buffer};
+
+            Protocol::AppConfigSchema::encode(config, writer);
+            size = writer.data().size();
+            checksum += buffer[size - 1];
+        }
+
+        const auto message     = std::span{buffer}.first(size);
+        const auto decodeStart = Clock::now();
+
+        const auto decodeAllocations = countAllocations([&] {
+            for (size_t i = 0; i < benchmarkIterations; i++) {
+                AppConfig decoded;
+
+                Protocol::AppConfigSchema::decode(message, decoded);
+                checksum += decoded.recording.rules.size();
+            }
+        });
+
+        const auto legacyStart = Clock::now();
+
+        const auto legacyAllocations = countAllocations([&] {
+            for (size_t i = 0; i < benchmarkIterations; i++) {
+                AppConfig decoded;
+
+                Legacy::decode(message, decoded);
+                checksum += decoded.recording.rules.size();
+            }
+        });
+
+        const auto end       = Clock::now();
+        const auto toNsPerOp = [](Clock::duration duration) {
+            return std::chrono::duration<double, std::nano>(duration).count() / benchmarkIterations;
+        };
+
+        std::printf("AppConfig of %zu bytes: encode %.0f ns, decode %.0f ns (%zu allocations), legacy decode %.0f ns "
+                    "(%zu allocations) (checksum %zu)\n",
+            size, toNsPerOp(decodeStart - encodeStart), toNsPerOp(legacyStart - decodeStart),
+            decodeAllocations / benchmarkIterations, toNsPerOp(end - legacyStart),
+            legacyAllocations / benchmarkIterations, checksum);
+    }
+} // namespace
+
+int main() {
+    testAppConfigRoundTrip();
+    testSystemInfoFitsOneTransfer();
+    testWorstCaseConfigFitsOneTransfer();
+    testExtendedRecordsInChunks();
+    testFixedBuffers();
+    testRejectsForeignMessages();
+    testDecodeAllocations();
+    benchmark();
+
+    return TestUtil::finish();
+}
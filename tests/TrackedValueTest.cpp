@@ -0,0 +1,98 @@
+#include "TestUtil.hpp"
+
+#include "TrackedValue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    constexpr size_t readerCount     = 6;
+    constexpr size_t writerCount     = 3;
+    constexpr size_t writesPerWriter = 20000;
+    constexpr size_t itemCount       = 64;
+
+    // Every element of a version equals its generation, so a torn read or a recycled slot shows up as a mismatch.
+    struct Version {
+        std::vector<uint32_t> items;
+        std::string tag;
+    };
+
+    void bump(Version& version) {
+        const auto next = version.items.front() + 1;
+
+        version.items.assign(itemCount, next);
+        version.tag = std::to_string(next);
+    }
+} // namespace
+
+// Readers pin snapshots while writers publish new versions, some of them while holding a snapshot themselves. Build
+// with `-DSANITIZE_THREADS=ON` to run it under ThreadSanitizer.
+int main() {
+    TrackedValue<Version> value{Version{std::vector<uint32_t>(itemCount, 0), "0"}};
+    std::atomic_bool stopped{};
+    std::atomic_size_t reads{};
+    std::atomic_size_t mismatches{};
+    std::vector<std::thread> readers;
+    std::vector<std::thread> writers;
+
+    for (size_t i = 0; i < readerCount; i++) {
+        readers.emplace_back([&] {
+            uint32_t lastGeneration{};
+
+            while (!stopped.load(std::memory_order_relaxed)) {
+                const auto snapshot   = value.snapshot();
+                const auto generation = snapshot.generation();
+
+                // Reads the version a few times over, to give a writer the chance to reuse the slot underneath.
+                for (size_t pass = 0; pass < 3; pass++) {
+                    mismatches += std::ranges::count_if(
+                        snapshot->items, [&](uint32_t item) { return item != generation; });
+                }
+
+                mismatches += generation < lastGeneration || snapshot->tag != std::to_string(generation);
+                lastGeneration = generation;
+                reads++;
+            }
+        });
+    }
+
+    for (size_t i = 0; i < writerCount; i++) {
+        writers.emplace_back([&] {
+            for (size_t j = 0; j < writesPerWriter; j++) {
+                if (j % 2 == 0) {
+                    [[maybe_unused]] const auto pinned = value.snapshot();
+
+                    value.modify(bump);
+                } else {
+                    value.modify(bump);
+                }
+            }
+        });
+    }
+
+    for (auto&& writer : writers) {
+        writer.join();
+    }
+
+    stopped = true;
+
+    for (auto&& reader : readers) {
+        reader.join();
+    }
+
+    const auto snapshot = value.snapshot();
+
+    std::printf("%zu reads, %zu mismatches\n", reads.load(), mismatches.load());
+    EXPECT(mismatches == 0);
+    EXPECT(reads > 0);
+    EXPECT(snapshot->items.front() == writerCount * writesPerWriter);
+    EXPECT(snapshot.generation() == writerCount * writesPerWriter);
+    EXPECT(value.generation() == writerCount * writesPerWriter);
+
+    return TestUtil::finish();
+}
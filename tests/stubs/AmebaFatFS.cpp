@@ -0,0 +1,29 @@
+#include "AmebaFatFS.h"
+
+#include "ff.h"
+
+bool AmebaFatFS::begin() {
+    FakeFat::format();
+
+    return true;
+}
+
+char* AmebaFatFS::getRootPath() {
+    static char rootPath[] = "0:/";
+
+    return rootPath;
+}
+
+bool AmebaFatFS::exists(const char* path) {
+    return f_stat(path, nullptr) == FR_OK;
+}
+
+bool AmebaFatFS::isDir(const char* path) {
+    FILINFO info;
+
+    return f_stat(path, &info) == FR_OK && (info.fattrib & AM_DIR) != 0;
+}
+
+bool AmebaFatFS::mkdir(const char* path) {
+    return f_mkdir(path) == FR_OK;
+}
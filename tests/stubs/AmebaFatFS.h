@@ -0,0 +1,12 @@
+#pragma once
+
+// Host stand-in for the SD card file system, on top of the FatFs stand-in in `ff.h`. Only what the storage code
+// needs to lay out directories is there.
+class AmebaFatFS {
+public:
+    bool begin();
+    char* getRootPath();
+    bool exists(const char* path);
+    bool isDir(const char* path);
+    bool mkdir(const char* path);
+};
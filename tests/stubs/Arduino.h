@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+// Host stand-in for the pin API the sources under test touch; interrupts are never raised on the host.
+#define INPUT_IRQ_FALL 0x04
+
+inline void pinMode(uint32_t, uint32_t) {}
+
+inline void digitalSetIrqHandler(uint32_t, void (*)(uint32_t, uint32_t)) {}
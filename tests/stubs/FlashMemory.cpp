@@ -0,0 +1,89 @@
+#include "FlashMemory.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+    constexpr size_t wordSize    = 4;
+    constexpr size_t sectorSize  = 0x1000;
+    constexpr uint8_t erasedByte = 0xFF;
+
+    std::array<uint8_t, sectorSize> buffer;
+    long wordsBeforePowerLoss = -1;
+    size_t erases{};
+    size_t words{};
+
+    void consumeWord() {
+        if (wordsBeforePowerLoss == 0) {
+            throw FakeFlash::PowerLoss{};
+        }
+
+        if (wordsBeforePowerLoss > 0) {
+            wordsBeforePowerLoss--;
+        }
+
+        words++;
+    }
+} // namespace
+
+FlashMemoryClass FlashMemory;
+
+FlashMemoryClass::FlashMemoryClass() : buf_size{sectorSize}, buf{buffer.data()} {}
+
+void FlashMemoryClass::begin(unsigned int flashBaseAddress, unsigned int flashSize) {
+    buf_size = flashSize;
+}
+
+void FlashMemoryClass::read(unsigned int offset) {
+    std::memcpy(buf, FakeFlash::memory().data() + offset, buf_size);
+}
+
+// The erase completes before the first word is programmed, so a cut leaves the sector partly erased.
+void FlashMemoryClass::write(unsigned int offset) {
+    const auto target = FakeFlash::memory().data() + offset;
+
+    erases++;
+    std::fill(target, target + buf_size, erasedByte);
+
+    for (size_t i = 0; i < buf_size; i += wordSize) {
+        consumeWord();
+        std::memcpy(target + i, buf + i, wordSize);
+    }
+}
+
+unsigned int FlashMemoryClass::readWord(unsigned int offset) {
+    unsigned int result;
+
+    std::memcpy(&result, FakeFlash::memory().data() + offset, wordSize);
+
+    return result;
+}
+
+void FlashMemoryClass::writeWord(unsigned int offset, unsigned int data) {
+    consumeWord();
+
+    const auto current = readWord(offset) & data;
+
+    std::memcpy(FakeFlash::memory().data() + offset, &current, wordSize);
+}
+
+namespace FakeFlash {
+    void cutPowerAfter(long words) {
+        wordsBeforePowerLoss = words;
+    }
+
+    std::vector<uint8_t>& memory() {
+        static std::vector<uint8_t> result(size, erasedByte);
+
+        return result;
+    }
+
+    size_t eraseCount() {
+        return erases;
+    }
+
+    size_t programmedWords() {
+        return words;
+    }
+} // namespace FakeFlash
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define FLASH_MEMORY_APP_BASE 0xFD000
+
+// Host stand-in for the flash driver with NOR semantics: `write` erases the sector and programs `buf` into it, and
+// `writeWord` can only clear bits. Offsets are relative to the mapped region.
+class FlashMemoryClass {
+public:
+    FlashMemoryClass();
+
+    void begin(unsigned int flashBaseAddress, unsigned int flashSize);
+    void read(unsigned int offset = 0);
+    void write(unsigned int offset = 0);
+    unsigned int readWord(unsigned int offset);
+    void writeWord(unsigned int offset, unsigned int data);
+
+    unsigned int buf_size;
+    unsigned char* buf;
+};
+
+extern FlashMemoryClass FlashMemory;
+
+// Lets the tests look at the whole flash and cut the power in the middle of a write.
+namespace FakeFlash {
+    constexpr size_t size = 0x8000;
+
+    // Thrown by the word that would have been programmed after the power was cut.
+    struct PowerLoss {};
+
+    // Cuts the power once `words` more words have been programmed; a negative count never cuts it.
+    void cutPowerAfter(long words);
+    std::vector<uint8_t>& memory();
+    size_t eraseCount();
+    size_t programmedWords();
+} // namespace FakeFlash
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Host stand-in for the FreeRTOS primitives the sources under test use: mutex semaphores map onto `std::mutex` and a
+// task delay yields the thread.
+using BaseType_t = int32_t;
+using TickType_t = uint32_t;
+
+struct QueueDefinition {
+    std::mutex mutex;
+};
+
+using SemaphoreHandle_t = QueueDefinition*;
+
+struct tskTaskControlBlock;
+
+using TaskHandle_t = tskTaskControlBlock*;
+
+#define pdTRUE             1
+#define pdFALSE            0
+#define portMAX_DELAY      0xFFFFFFFFU
+#define portTICK_PERIOD_MS 1
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new QueueDefinition;
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t) {
+    semaphore->mutex.lock();
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    semaphore->mutex.unlock();
+    return pdTRUE;
+}
+
+inline void vTaskDelay(TickType_t) {
+    std::this_thread::yield();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+// Host stand-in for the log UART. The sources under test only report through it, so everything is discarded.
+class LOGUARTClass {
+public:
+    template <typename... Args>
+    size_t print(const Args&...) noexcept {
+        return 0;
+    }
+
+    template <typename... Args>
+    size_t println(const Args&...) noexcept {
+        return 0;
+    }
+};
+
+inline LOGUARTClass Serial;
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Host stand-in for the Arduino `String`, backed by `std::string`. `length` returns `size_t` as the target's
+// `unsigned int` does, so that mixed `std::min` calls deduce one type on 64-bit hosts too.
+class String {
+public:
+    String(const char* value = "") : value_{value} {}
+
+    const char* c_str() const noexcept {
+        return value_.c_str();
+    }
+
+    size_t length() const noexcept {
+        return value_.size();
+    }
+
+    bool operator==(const String& other) const = default;
+
+    friend String operator+(const String& left, const String& right) {
+        return (left.value_ + right.value_).c_str();
+    }
+
+private:
+    std::string value_;
+};
@@ -0,0 +1,59 @@
+#include "Wire.h"
+
+#include <utility>
+
+TwoWire Wire;
+
+void TwoWire::begin() {}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    pending_ = {address, {}};
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    if (pending_.bytes.empty()) {
+        return 0;
+    }
+
+    pointer_ = pending_.bytes.front();
+
+    for (size_t i = 1; i < pending_.bytes.size(); i++) {
+        auto&& target    = registers[pointer_];
+        const auto value = pending_.bytes[i];
+
+        target = (value & ~clearOnly[pointer_]) | (target & value & clearOnly[pointer_]);
+        pointer_++;
+    }
+
+    writes.push_back(std::move(pending_));
+    pending_ = {};
+
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(int address, int quantity) {
+    reads++;
+    remaining_ = quantity;
+
+    return static_cast<uint8_t>(quantity);
+}
+
+size_t TwoWire::write(uint8_t data) {
+    pending_.bytes.push_back(data);
+
+    return 1;
+}
+
+int TwoWire::read() {
+    if (remaining_ == 0) {
+        return -1;
+    }
+
+    remaining_--;
+
+    return registers[pointer_++];
+}
+
+int TwoWire::available() {
+    return remaining_;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Host stand-in for the I2C bus with one register-file device behind it. Like the DS3231 and most register devices,
+// the first byte of a write sets the register pointer, and every byte read or written advances it. Bits set in
+// `clearOnly` can only be cleared by writing 0, like alarm flags.
+class TwoWire {
+public:
+    struct Transaction {
+        uint8_t address;
+        std::vector<uint8_t> bytes;
+    };
+
+    void begin();
+    void beginTransmission(uint8_t address);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(int address, int quantity);
+    size_t write(uint8_t data);
+    int read();
+    int available();
+
+    std::array<uint8_t, 0x100> registers{};
+    std::array<uint8_t, 0x100> clearOnly{};
+    // Every completed write, in bus order.
+    std::vector<Transaction> writes;
+    size_t reads{};
+
+private:
+    Transaction pending_{};
+    uint8_t pointer_{};
+    int remaining_{};
+};
+
+extern TwoWire Wire;
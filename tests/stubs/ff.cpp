@@ -0,0 +1,513 @@
+#include "ff.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    constexpr size_t entriesPerSector    = 512 / 32;
+    constexpr size_t sectorsPerCluster   = 64; // 32 KB clusters, the SD default for FAT32
+    constexpr size_t entriesPerCluster   = entriesPerSector * sectorsPerCluster;
+    constexpr size_t fatEntriesPerSector = 512 / 4;
+    constexpr size_t lfnCharsPerEntry    = 13;
+    constexpr size_t maxNumberedNames    = 100;
+    constexpr DWORD rootCluster          = 2;
+    constexpr QWORD fatStart             = 32;
+    constexpr QWORD dataStart            = 1 << 20;
+    constexpr QWORD noSector             = ~QWORD{};
+
+    enum class EntryKind : uint8_t {
+        longName,
+        file,
+        directory,
+        deleted,
+    };
+
+    // The long name is kept on the short name entry it belongs to.
+    struct Entry {
+        EntryKind kind;
+        std::string shortName;
+        std::string longName;
+        DWORD cluster;
+    };
+
+    struct Directory {
+        std::vector<Entry> entries;
+        std::vector<DWORD> clusters;
+    };
+
+    struct Location {
+        DWORD parent;
+        std::optional<size_t> index;
+        std::string name;
+    };
+
+    std::map<DWORD, Directory> directories;
+    DWORD nextFreeCluster;
+    QWORD windowSector;
+    bool windowDirty;
+    size_t reads;
+    size_t writes;
+
+    // FatFs moves one sector window for both the FAT and the directories, writing it back first when dirty.
+    void moveWindow(QWORD sector) {
+        if (sector == windowSector) {
+            return;
+        }
+
+        if (windowDirty) {
+            writes++;
+            windowDirty = false;
+        }
+
+        reads++;
+        windowSector = sector;
+    }
+
+    void syncWindow() {
+        if (windowDirty) {
+            writes++;
+            windowDirty = false;
+        }
+    }
+
+    QWORD fatSector(DWORD cluster) {
+        return fatStart + cluster / fatEntriesPerSector;
+    }
+
+    QWORD dataSector(DWORD cluster, size_t sector) {
+        return dataStart + static_cast<QWORD>(cluster - rootCluster) * sectorsPerCluster + sector;
+    }
+
+    // Loads the sector holding entry `index`. Stepping into the next cluster follows the chain through the FAT.
+    void loadEntry(const Directory& directory, size_t index) {
+        if (index != 0 && index % entriesPerCluster == 0) {
+            moveWindow(fatSector(directory.clusters[index / entriesPerCluster - 1]));
+        }
+
+        const auto cluster = directory.clusters[index / entriesPerCluster];
+
+        moveWindow(dataSector(cluster, index % entriesPerCluster / entriesPerSector));
+    }
+
+    // Links a cluster to the chain and clears it sector by sector, as FatFs does for a growing directory.
+    DWORD allocateCluster(Directory& directory) {
+        const auto cluster = nextFreeCluster++;
+
+        moveWindow(fatSector(cluster));
+        windowDirty = true;
+
+        if (!directory.clusters.empty()) {
+            moveWindow(fatSector(directory.clusters.back()));
+            windowDirty = true;
+        }
+
+        syncWindow();
+        writes += sectorsPerCluster;
+        windowSector = dataSector(cluster, 0);
+        directory.clusters.push_back(cluster);
+
+        return cluster;
+    }
+
+    // Scans from the first entry until `matches` holds for an entry, or up to the end marker.
+    template <typename Predicate>
+    std::optional<size_t> findEntry(const Directory& directory, Predicate&& matches) {
+        for (size_t index = 0;; index++) {
+            if (index == directory.clusters.size() * entriesPerCluster) {
+                moveWindow(fatSector(directory.clusters.back()));
+                return std::nullopt;
+            }
+
+            loadEntry(directory, index);
+
+            if (index == directory.entries.size()) {
+                return std::nullopt;
+            }
+
+            if (auto&& entry = directory.entries[index];
+                (entry.kind == EntryKind::file || entry.kind == EntryKind::directory) && matches(entry)) {
+                return index;
+            }
+        }
+    }
+
+    bool equalsIgnoringCase(std::string_view left, std::string_view right) {
+        return std::ranges::equal(left, right, [](char a, char b) { return std::toupper(a) == std::toupper(b); });
+    }
+
+    std::optional<size_t> findName(const Directory& directory, std::string_view name) {
+        return findEntry(directory, [&](const Entry& entry) {
+            return equalsIgnoringCase(entry.longName, name) || equalsIgnoringCase(entry.shortName, name);
+        });
+    }
+
+    // Builds the 11 character 8.3 name; returns whether information was lost, which calls for a numbered name.
+    bool toShortName(std::string_view name, std::string& shortName) {
+        const auto dot  = name.rfind('.');
+        const auto body = name.substr(0, dot);
+        const auto ext  = dot == std::string_view::npos ? std::string_view{} : name.substr(dot + 1);
+        auto lossy      = body.size() > 8 || ext.size() > 3;
+        const auto copy = [&](std::string_view part, size_t size) {
+            std::string result;
+
+            for (auto c : part) {
+                if (result.size() == size) {
+                    break;
+                }
+
+                if (c == '.' || c == ' ') {
+                    lossy = true;
+                    continue;
+                }
+
+                if (std::strchr("+,;=[]", c)) {
+                    lossy = true;
+                    c     = '_';
+                }
+
+                result += static_cast<char>(std::toupper(c));
+            }
+
+            result.resize(size, ' ');
+
+            return result;
+        };
+
+        shortName = copy(body, 8) + copy(ext, 3);
+
+        return lossy;
+    }
+
+    // FatFs's gen_numname: `~1` to `~5` first, then a hash of the long name to avoid scanning for long.
+    std::string numberedName(const std::string& shortName, std::string_view longName, UINT seq) {
+        if (seq > 5) {
+            DWORD sreg = seq;
+
+            for (auto c : longName) {
+                auto wc = static_cast<WORD>(static_cast<unsigned char>(c));
+
+                for (size_t i = 0; i < 16; i++) {
+                    sreg = (sreg << 1) + (wc & 1);
+                    wc >>= 1;
+
+                    if (sreg & 0x10000) {
+                        sreg ^= 0x11021;
+                    }
+                }
+            }
+
+            seq = static_cast<UINT>(sreg);
+        }
+
+        char number[8];
+        size_t i = 7;
+
+        do {
+            const auto digit = static_cast<char>(seq % 16);
+
+            number[i--] = static_cast<char>(digit < 10 ? '0' + digit : 'A' + digit - 10);
+            seq /= 16;
+        } while (i != 0 && seq != 0);
+
+        number[i] = '~';
+
+        auto result = shortName;
+        size_t j    = 0;
+
+        while (j < i && result[j] != ' ') {
+            j++;
+        }
+
+        do {
+            result[j++] = i < 8 ? number[i++] : ' ';
+        } while (j < 8);
+
+        return result;
+    }
+
+    // Finds `count` consecutive free entries from the start, growing the directory by a cluster when it runs out.
+    size_t allocateEntries(Directory& directory, size_t count) {
+        size_t free{};
+
+        for (size_t index = 0;; index++) {
+            if (index == directory.clusters.size() * entriesPerCluster) {
+                moveWindow(fatSector(directory.clusters.back()));
+                allocateCluster(directory);
+            }
+
+            loadEntry(directory, index);
+
+            free = index >= directory.entries.size() || directory.entries[index].kind == EntryKind::deleted ? free + 1
+                                                                                                           : 0;
+
+            if (free == count) {
+                return index + 1 - count;
+            }
+        }
+    }
+
+    FRESULT registerEntry(Directory& directory, const std::string& name, EntryKind kind, DWORD cluster, size_t& index) {
+        std::string shortName;
+        const auto lossy = toShortName(name, shortName);
+        const auto mixed = std::ranges::any_of(name, ::islower) && std::ranges::any_of(name, ::isupper);
+
+        if (lossy) {
+            const auto base = shortName;
+            UINT seq        = 1;
+
+            for (; seq < maxNumberedNames; seq++) {
+                shortName = numberedName(base, name, seq);
+
+                if (!findEntry(directory, [&](const Entry& entry) { return entry.shortName == shortName; })) {
+                    break;
+                }
+            }
+
+            if (seq == maxNumberedNames) {
+                return FR_DENIED;
+            }
+        }
+
+        const auto longEntries = lossy || mixed ? (name.size() + lfnCharsPerEntry - 1) / lfnCharsPerEntry : 0;
+        const auto first       = allocateEntries(directory, longEntries + 1);
+
+        index = first + longEntries;
+
+        if (directory.entries.size() < index + 1) {
+            directory.entries.resize(index + 1, Entry{EntryKind::deleted, {}, {}, 0});
+        }
+
+        for (auto i = first; i <= index; i++) {
+            loadEntry(directory, i);
+            windowDirty          = true;
+            directory.entries[i] = i == index ? Entry{kind, shortName, name, cluster} : Entry{EntryKind::longName};
+        }
+
+        return FR_OK;
+    }
+
+    // Walks the path one directory search per component, as follow_path does.
+    FRESULT followPath(std::string_view path, Location& location) {
+        if (path.starts_with("0:")) {
+            path.remove_prefix(2);
+        }
+
+        location = {rootCluster, std::nullopt, {}};
+
+        while (!path.empty() && path.front() == '/') {
+            path.remove_prefix(1);
+        }
+
+        while (!path.empty()) {
+            const auto separator = path.find('/');
+            const auto name      = path.substr(0, separator);
+
+            path.remove_prefix(separator == std::string_view::npos ? path.size() : separator + 1);
+            location.name = name;
+            location.index.reset();
+
+            if (name.empty()) {
+                continue;
+            }
+
+            location.index = findName(directories[location.parent], name);
+
+            if (path.empty()) {
+                break;
+            }
+
+            if (!location.index) {
+                return FR_NO_PATH;
+            }
+
+            auto&& entry = directories[location.parent].entries[*location.index];
+
+            if (entry.kind != EntryKind::directory) {
+                return FR_NO_PATH;
+            }
+
+            location.parent = entry.cluster;
+        }
+
+        return FR_OK;
+    }
+
+    void fillInfo(const Entry& entry, FILINFO& info) {
+        info = {};
+        info.fattrib = entry.kind == EntryKind::directory ? AM_DIR : 0;
+        std::snprintf(info.fname, sizeof(info.fname), "%s", entry.longName.c_str());
+    }
+} // namespace
+
+FRESULT f_open(FIL* fp, const TCHAR* path, BYTE mode) {
+    Location location;
+
+    if (const auto result = followPath(path, location); result != FR_OK) {
+        return result;
+    }
+
+    auto&& directory = directories[location.parent];
+
+    if (location.index) {
+        if ((mode & FA_CREATE_NEW) != 0) {
+            return FR_EXIST;
+        }
+
+        if (directory.entries[*location.index].kind == EntryKind::directory) {
+            return FR_NO_FILE;
+        }
+
+        *fp = {location.parent, *location.index};
+
+        return FR_OK;
+    }
+
+    if ((mode & (FA_CREATE_NEW | FA_CREATE_ALWAYS | FA_OPEN_ALWAYS)) == 0) {
+        return FR_NO_FILE;
+    }
+
+    size_t index{};
+
+    if (const auto result = registerEntry(directory, location.name, EntryKind::file, 0, index); result != FR_OK) {
+        return result;
+    }
+
+    *fp = {location.parent, index};
+
+    return FR_OK;
+}
+
+// Writes the directory entry back, as f_sync does.
+FRESULT f_close(FIL* fp) {
+    loadEntry(directories[fp->directory], fp->entry);
+    windowDirty = true;
+    syncWindow();
+
+    return FR_OK;
+}
+
+FRESULT f_mkdir(const TCHAR* path) {
+    Location location;
+
+    if (const auto result = followPath(path, location); result != FR_OK) {
+        return result;
+    }
+
+    if (location.index) {
+        return FR_EXIST;
+    }
+
+    Directory created;
+    const auto cluster = allocateCluster(created);
+
+    created.entries      = {{EntryKind::directory, ".          ", ".", cluster},
+        {EntryKind::directory, "..         ", "..", location.parent}};
+    windowDirty          = true;
+    directories[cluster] = std::move(created);
+
+    auto&& parent = directories[location.parent];
+    size_t index{};
+    const auto result = registerEntry(parent, location.name, EntryKind::directory, cluster, index);
+
+    syncWindow();
+
+    return result;
+}
+
+FRESULT f_stat(const TCHAR* path, FILINFO* fno) {
+    Location location;
+
+    if (const auto result = followPath(path, location); result != FR_OK) {
+        return result;
+    }
+
+    if (!location.index) {
+        return FR_NO_FILE;
+    }
+
+    if (fno) {
+        fillInfo(directories[location.parent].entries[*location.index], *fno);
+    }
+
+    return FR_OK;
+}
+
+FRESULT f_opendir(DIR* dp, const TCHAR* path) {
+    Location location;
+
+    if (const auto result = followPath(path, location); result != FR_OK) {
+        return result;
+    }
+
+    if (!location.index) {
+        if (!location.name.empty()) {
+            return FR_NO_PATH;
+        }
+
+        *dp = {location.parent, 0};
+
+        return FR_OK;
+    }
+
+    auto&& entry = directories[location.parent].entries[*location.index];
+
+    if (entry.kind != EntryKind::directory) {
+        return FR_NO_PATH;
+    }
+
+    *dp = {entry.cluster, 0};
+
+    return FR_OK;
+}
+
+// Skips long name parts, deleted entries and the dot entries, like dir_read with long names enabled.
+FRESULT f_readdir(DIR* dp, FILINFO* fno) {
+    auto&& directory = directories[dp->directory];
+
+    for (; dp->index < directory.entries.size(); dp->index++) {
+        loadEntry(directory, dp->index);
+
+        if (auto&& entry = directory.entries[dp->index];
+            (entry.kind == EntryKind::file || entry.kind == EntryKind::directory) && entry.longName.front() != '.') {
+            fillInfo(entry, *fno);
+            dp->index++;
+
+            return FR_OK;
+        }
+    }
+
+    fno->fname[0] = '\0';
+
+    return FR_OK;
+}
+
+FRESULT f_closedir(DIR*) {
+    return FR_OK;
+}
+
+namespace FakeFat {
+    void format() {
+        directories.clear();
+        directories[rootCluster].clusters.push_back(rootCluster);
+        nextFreeCluster = rootCluster + 1;
+        windowSector    = noSector;
+        windowDirty     = false;
+        reads           = 0;
+        writes          = 0;
+    }
+
+    size_t sectorReads() {
+        return reads;
+    }
+
+    size_t sectorWrites() {
+        return writes;
+    }
+} // namespace FakeFat
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Host stand-in for the FatFs subset the sketch uses, over a FAT32 volume model that keeps directory entries only.
+// Lookups, name generation and entry allocation follow FatFs: every directory search is a linear scan through a
+// single sector window, long names take one entry per 13 characters, and a long name that is not a valid 8.3 name
+// gets a numbered short name, which is checked against the directory once per candidate.
+
+typedef unsigned int UINT;
+typedef unsigned char BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef uint64_t QWORD;
+typedef DWORD FSIZE_t;
+typedef char TCHAR;
+
+typedef enum {
+    FR_OK = 0,
+    FR_DISK_ERR,
+    FR_INT_ERR,
+    FR_NOT_READY,
+    FR_NO_FILE,
+    FR_NO_PATH,
+    FR_INVALID_NAME,
+    FR_DENIED,
+    FR_EXIST,
+    FR_INVALID_OBJECT,
+} FRESULT;
+
+#define FA_READ          0x01
+#define FA_WRITE         0x02
+#define FA_OPEN_EXISTING 0x00
+#define FA_CREATE_NEW    0x04
+#define FA_CREATE_ALWAYS 0x08
+#define FA_OPEN_ALWAYS   0x10
+
+#define AM_DIR 0x10
+
+struct FIL {
+    DWORD directory;
+    size_t entry;
+};
+
+struct DIR {
+    DWORD directory;
+    size_t index;
+};
+
+struct FILINFO {
+    FSIZE_t fsize;
+    WORD fdate;
+    WORD ftime;
+    BYTE fattrib;
+    TCHAR altname[13];
+    TCHAR fname[256];
+};
+
+FRESULT f_open(FIL* fp, const TCHAR* path, BYTE mode);
+FRESULT f_close(FIL* fp);
+FRESULT f_mkdir(const TCHAR* path);
+FRESULT f_stat(const TCHAR* path, FILINFO* fno);
+FRESULT f_opendir(DIR* dp, const TCHAR* path);
+FRESULT f_readdir(DIR* dp, FILINFO* fno);
+FRESULT f_closedir(DIR* dp);
+
+// Lets the tests start from an empty volume and count the sector transfers, the cost that grows with a directory.
+namespace FakeFat {
+    void format();
+    size_t sectorReads();
+    size_t sectorWrites();
+} // namespace FakeFat
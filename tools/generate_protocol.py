@@ -0,0 +1,519 @@
+#!/usr/bin/env python3
+"""Generates the TLV codecs of the firmware and the web UI from `tools/protocol.json`.
+
+    python3 tools/generate_protocol.py          # rewrite ProtocolSchema.hpp and html/protocol.js
+    python3 tools/generate_protocol.py --check  # fail if either file is stale
+
+Each message lists its fields with a type ID, a name and a wire type (bool, u8, u16, u32, u64, string or bytes).
+
+- `path` is the member the field maps to on the C++ side, dotted for nested structs. It defaults to the name. Messages
+  without `cppType` get a generated struct in `namespace Protocol` instead, where the path is always the name.
+- `repeated` spreads element `i` over the types `type + i * stride`. The element is either a scalar of `wire`, or a
+  struct whose `fields` have types relative to the stride.
+- `packed` splits a scalar into named bit ranges, least significant first. On the C++ side the parts are members of
+  the enclosing object; on the JS side they are properties of the enclosing object.
+- `section` groups the top-level fields of a message, for C++ code that reacts to changes of one group only.
+  `<Message>Section` and `<message>SectionOf(type)` are generated when any field has one.
+- `targets` restricts a message to "cpp" or "js".
+"""
+
+import argparse
+import json
+import pathlib
+import sys
+import textwrap
+
+ROOT = pathlib.Path(__file__).resolve().parent.parent
+SCHEMA_PATH = ROOT / "tools" / "protocol.json"
+CPP_PATH = ROOT / "ProtocolSchema.hpp"
+JS_PATH = ROOT / "html" / "protocol.js"
+
+LINE_LIMIT = 120
+HEADER = "Generated by tools/generate_protocol.py from tools/protocol.json. Do not edit."
+
+WIRE_SIZES = {"bool": 1, "u8": 1, "u16": 2, "u32": 4, "u64": 8}
+CPP_WIRE_TYPES = {"bool": "uint8_t", "u8": "uint8_t", "u16": "uint16_t", "u32": "uint32_t", "u64": "uint64_t"}
+CPP_MEMBER_TYPES = {"bool": "bool", "u8": "uint8_t", "u16": "uint16_t", "u32": "uint32_t", "u64": "uint64_t",
+                    "string": "String"}
+JS_WRITERS = {"bool": "writeUInt8", "u8": "writeUInt8", "u16": "writeUInt16", "u32": "writeUInt32",
+              "u64": "writeUInt64"}
+
+
+class SchemaError(Exception):
+    pass
+
+
+def targets(message):
+    return message.get("targets", ["cpp", "js"])
+
+
+def path_of(field):
+    return field.get("path", field["name"])
+
+
+def member(variable, path):
+    return f"{variable}.{path}" if path else variable
+
+
+def accessor(variable, path):
+    return f"[](auto& {variable}) -> auto& {{ return {member(variable, path)}; }}"
+
+
+def validate(messages):
+    for message in messages:
+        owners = {}
+
+        for field in message["fields"]:
+            wire = field.get("wire")
+
+            if "fields" not in field and wire not in WIRE_SIZES and wire not in ("string", "bytes"):
+                raise SchemaError(f"{message['name']}.{field['name']}: unknown wire type {wire!r}.")
+
+            if wire == "bytes" and "cpp" in targets(message):
+                raise SchemaError(f"{message['name']}.{field['name']}: bytes fields are JS only.")
+
+            if "packed" in field and sum(part["bits"] for part in field["packed"]) > WIRE_SIZES[wire] * 8:
+                raise SchemaError(f"{message['name']}.{field['name']}: packed parts exceed the wire size.")
+
+            count = field["repeated"]["maxCount"] if "repeated" in field else 1
+            stride = field["repeated"]["stride"] if "repeated" in field else 1
+
+            if field["type"] + stride * count > 0x100:
+                raise SchemaError(f"{message['name']}.{field['name']}: type IDs run past 255.")
+
+            for index in range(count):
+                offsets = [element["type"] for element in field["fields"]] if "fields" in field else [0]
+
+                for offset in offsets:
+                    if offset >= stride:
+                        raise SchemaError(f"{message['name']}.{field['name']}: element type outside the stride.")
+
+                    type_id = field["type"] + index * stride + offset
+
+                    if type_id in owners:
+                        raise SchemaError(f"{message['name']}: type {type_id} is used by {owners[type_id]} and "
+                                          f"{field['name']}.")
+
+                    owners[type_id] = field["name"]
+
+
+# C++
+
+def cpp_codec(field, variable):
+    wire = CPP_WIRE_TYPES[field["wire"]]
+
+    if "packed" not in field:
+        return f"TlvSchema::As<{wire}>"
+
+    parts = ", ".join(f"TlvSchema::Bits<{accessor(variable, path_of(part))}, {part['bits']}>"
+                      for part in field["packed"])
+
+    return f"TlvSchema::Packed<{wire}, {parts}>"
+
+
+def cpp_comment(text, indent):
+    return textwrap.wrap(text, LINE_LIMIT, initial_indent=indent + "// ", subsequent_indent=indent + "// ")
+
+
+# Returns the lines of one field, without the separator that follows it. The codec moves to its own line, and packed
+# parts to one line each, when the field would not fit.
+def cpp_scalar(type_id, field, variable, path, indent):
+    if field["wire"] == "string":
+        return [f"{indent}TlvSchema::StringField<{type_id}, {accessor(variable, path)}, {field['maxSize']}>"]
+
+    head = f"{indent}TlvSchema::Field<{type_id}, {accessor(variable, path)},"
+    line = f"{head} {cpp_codec(field, variable)}>"
+
+    if len(line) + 2 <= LINE_LIMIT:
+        return [line]
+
+    if "packed" not in field:
+        return [head, f"{indent}    {cpp_codec(field, variable)}>"]
+
+    lines = [head, f"{indent}    TlvSchema::Packed<{CPP_WIRE_TYPES[field['wire']]},"]
+    lines += [f"{indent}        TlvSchema::Bits<{accessor(variable, path_of(part))}, {part['bits']}>,"
+              for part in field["packed"]]
+    lines[-1] = lines[-1][:-1] + ">>"
+
+    return lines
+
+
+def cpp_field(field, indent):
+    if "repeated" not in field:
+        return cpp_scalar(field["type"], field, "message", path_of(field), indent)
+
+    repeated = field["repeated"]
+    head = (f"TlvSchema::Repeated<{field['type']}, {repeated['stride']}, {repeated['maxCount']}, "
+            f"{accessor('message', path_of(field))},")
+
+    if "fields" in field:
+        elements = [cpp_scalar(element["type"], element, "item", path_of(element), indent + "    ")
+                    for element in field["fields"]]
+    else:
+        elements = [cpp_scalar(0, field, "item", "", indent + "    ")]
+
+    lines = [indent + head]
+
+    for element in elements:
+        lines += element[:-1]
+        lines.append(element[-1] + ",")
+
+    lines[-1] = lines[-1][:-1] + ">"
+
+    return lines
+
+
+def lower_first(name):
+    return name[0].lower() + name[1:]
+
+
+def cpp_sections(message):
+    sections = list(dict.fromkeys(field["section"] for field in message["fields"] if "section" in field))
+
+    if not sections:
+        return []
+
+    name = message["name"]
+    lines = [f"    enum class {name}Section : uint8_t {{"]
+    lines += [f"        {section}," for section in sections]
+    lines += ["    };",
+              "",
+              f"    inline constexpr size_t {lower_first(name)}SectionCount = {len(sections)};",
+              "",
+              f"    // The section owning a record type, or nothing for types outside the message.",
+              f"    constexpr std::optional<{name}Section> {lower_first(name)}SectionOf(uint8_t type) noexcept {{"]
+    cases = {}
+
+    for field in message["fields"]:
+        if "section" not in field:
+            continue
+
+        if "repeated" in field:
+            end = field["type"] + field["repeated"]["stride"] * field["repeated"]["maxCount"]
+            lines += [f"        if (type >= {field['type']} && type < {end}) {{",
+                      f"            return {name}Section::{field['section']};",
+                      "        }",
+                      ""]
+        else:
+            cases.setdefault(field["section"], []).append(field["type"])
+
+    lines.append("        switch (type) {")
+
+    for section, types in cases.items():
+        lines += [f"            case {type_id}:" for type_id in types]
+        lines.append(f"                return {name}Section::{section};")
+
+    lines += ["            default:",
+              "                return std::nullopt;",
+              "        }",
+              "    }",
+              ""]
+
+    return lines
+
+
+def cpp_struct(message):
+    lines = [f"    struct {message['name']} {{"]
+
+    for field in message["fields"]:
+        if "fields" in field or "packed" in field:
+            raise SchemaError(f"{message['name']}.{field['name']}: give the message a cppType to nest structs.")
+
+        member_type = CPP_MEMBER_TYPES[field["wire"]]
+        initializer = "" if member_type == "String" else "{}"
+
+        if "repeated" in field:
+            member_type = f"std::array<{member_type}, {field['repeated']['maxCount']}>"
+            initializer = "{}"
+
+        lines.append(f"        {member_type} {field['name']}{initializer};")
+
+    lines.append("    };")
+
+    return lines
+
+
+def generate_cpp(messages):
+    lines = [
+        f"// {HEADER}",
+        "#pragma once",
+        "",
+        '#include "TlvSchema.hpp"',
+        "",
+        "#include <array>",
+        "#include <cstddef>",
+        "#include <cstdint>",
+        "#include <optional>",
+        "",
+        "#include <WString.h>",
+        "",
+        "namespace Protocol {",
+    ]
+
+    for message in messages:
+        if "cpp" not in targets(message):
+            continue
+
+        lines += cpp_comment(message["comment"], "    ")
+
+        if "cppType" not in message:
+            lines += cpp_struct(message)
+            lines.append("")
+
+        lines.append(f"    using {message['name']}Schema = TlvSchema::Schema<")
+
+        fields = [cpp_field(field, "        ") for field in message["fields"]]
+
+        for index, field_lines in enumerate(fields):
+            last = index == len(fields) - 1
+            lines += field_lines[:-1]
+            lines.append(field_lines[-1] + (">;" if last else ","))
+
+        lines.append("")
+        lines += cpp_sections(message)
+
+    lines[-1] = "} // namespace Protocol"
+
+    return "\n".join(lines) + "\n"
+
+
+# JS
+
+def js_name(message):
+    return message["name"]
+
+
+def js_packed_value(field, item):
+    parts = []
+    shift = 0
+
+    for part in field["packed"]:
+        mask = (1 << part["bits"]) - 1
+        value = f"(({item}.{part['name']} ?? 0) & 0x{mask:X})"
+        parts.append(value if shift == 0 else f"({value} << {shift})")
+        shift += part["bits"]
+
+    return "(" + " | ".join(parts) + ") >>> 0"
+
+
+def js_write(field, type_expr, value):
+    wire = field["wire"]
+
+    if wire == "string":
+        return f"writer.writeString({type_expr}, {value}, {field['maxSize']});"
+
+    if wire == "bytes":
+        return f"writer.write({type_expr}, {value});"
+
+    if wire == "bool":
+        return f"writer.writeUInt8({type_expr}, {value} ? 1 : 0);"
+
+    return f"writer.{JS_WRITERS[wire]}({type_expr}, {value});"
+
+
+def js_encode_scalar(field, type_expr, item, indent):
+    if "packed" in field:
+        defined = " || ".join(f"{item}.{part['name']} !== undefined" for part in field["packed"])
+        value = js_packed_value(field, item)
+
+        return [f"{indent}if ({defined}) {{",
+                f"{indent}    writer.{JS_WRITERS[field['wire']]}({type_expr}, {value});",
+                f"{indent}}}"]
+
+    value = f"{item}.{field['name']}"
+
+    return [f"{indent}if ({value} !== undefined) {{",
+            f"{indent}    {js_write(field, type_expr, value)}",
+            f"{indent}}}"]
+
+
+def js_type_expr(base, stride, offset):
+    expr = f"{base + offset} + i" if stride == 1 else f"{base + offset} + i * {stride}"
+
+    return expr
+
+
+def js_encode(message):
+    lines = [f"export function encode{js_name(message)}(message) {{",
+             "    const writer = new TlvWriter();",
+             "",
+             "    writer.writeMagic();",
+             ""]
+
+    for field in message["fields"]:
+        if "repeated" not in field:
+            lines += js_encode_scalar(field, str(field["type"]), "message", "    ")
+            lines.append("")
+            continue
+
+        repeated = field["repeated"]
+        lines += [f"    const {field['name']} = message.{field['name']} ?? [];",
+                  "",
+                  f"    for (let i = 0; i < Math.min({field['name']}.length, {repeated['maxCount']}); i++) {{"]
+
+        if "fields" in field:
+            lines.append(f"        const item = {field['name']}[i];")
+            lines.append("")
+
+            for index, element in enumerate(field["fields"]):
+                type_expr = js_type_expr(field["type"], repeated["stride"], element["type"])
+                lines += js_encode_scalar(element, type_expr, "item", "        ")
+
+                if index != len(field["fields"]) - 1:
+                    lines.append("")
+        else:
+            type_expr = js_type_expr(field["type"], repeated["stride"], 0)
+            lines += [f"        if ({field['name']}[i] !== undefined) {{",
+                      f"            {js_write(field, type_expr, field['name'] + '[i]')}",
+                      "        }"]
+
+        lines += ["    }", ""]
+
+    lines += ["    return writer.toArrayBuffer();", "}"]
+
+    return lines
+
+
+def js_read(field):
+    wire = field["wire"]
+
+    if wire == "string":
+        return "'string'", "value"
+
+    if wire == "bytes":
+        return "'bytes'", "value"
+
+    if wire == "bool":
+        return "'number'", "value !== 0"
+
+    if wire == "u64":
+        return "'number'", "Number(value)"
+
+    return "'number'", "value"
+
+
+def js_decode_scalar(field, type_expr, target, indent):
+    data_type, value = js_read(field)
+
+    if "packed" not in field:
+        return [f"{indent}reader.registerHandler({type_expr}, {data_type}, (_, value) => {target}.{field['name']} = "
+                f"{value});"]
+
+    lines = [f"{indent}reader.registerHandler({type_expr}, {data_type}, (_, value) => {{"]
+
+    if not target.startswith("message"):
+        lines.append(f"{indent}    const item = {target};")
+        lines.append("")
+        target = "item"
+
+    shift = 0
+
+    for part in field["packed"]:
+        mask = (1 << part["bits"]) - 1
+        shifted = "value" if shift == 0 else f"(value >>> {shift})"
+        lines.append(f"{indent}    {target}.{part['name']} = {shifted} & 0x{mask:X};")
+        shift += part["bits"]
+
+    lines.append(f"{indent}}});")
+
+    return lines
+
+
+def js_decode(message):
+    lines = [f"export function decode{js_name(message)}(arrayBuffer) {{",
+             "    const reader = new TlvReader(arrayBuffer);"]
+    arrays = [f"        {field['name']}: []," for field in message["fields"] if "repeated" in field]
+
+    if arrays:
+        lines += ["    const message = {"] + arrays + ["    };"]
+    else:
+        lines.append("    const message = {};")
+
+    for index, field in enumerate(message["fields"]):
+        if "repeated" not in field:
+            if index == 0 or "repeated" in message["fields"][index - 1]:
+                lines.append("")
+
+            lines += js_decode_scalar(field, str(field["type"]), "message", "    ")
+            continue
+
+        repeated = field["repeated"]
+        lines += ["",
+                  f"    for (let i = 0; i < {repeated['maxCount']}; i++) {{"]
+
+        if "fields" in field:
+            for element in field["fields"]:
+                type_expr = js_type_expr(field["type"], repeated["stride"], element["type"])
+                lines += js_decode_scalar(element, type_expr, f"element(message.{field['name']}, i)", "        ")
+        else:
+            type_expr = js_type_expr(field["type"], repeated["stride"], 0)
+            data_type, value = js_read(field)
+            lines.append(f"        reader.registerHandler({type_expr}, {data_type}, (_, value) => "
+                         f"message.{field['name']}[i] = {value});")
+
+        lines.append("    }")
+
+    lines += ["", "    reader.readAll();", "", "    return message;", "}"]
+
+    return lines
+
+
+def generate_js(messages):
+    lines = [
+        f"// {HEADER}",
+        'import { TlvReader, TlvWriter } from "./tlv";',
+        "",
+        "// Grows `items` with empty objects so that `items[index]` exists.",
+        "function element(items, index) {",
+        "    while (items.length <= index) {",
+        "        items.push({});",
+        "    }",
+        "",
+        "    return items[index];",
+        "}",
+    ]
+
+    for message in messages:
+        if "js" not in targets(message):
+            continue
+
+        lines.append("")
+        lines += cpp_comment(message["comment"], "")
+        lines += js_encode(message)
+        lines.append("")
+        lines += js_decode(message)
+
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate the TLV codecs from tools/protocol.json.")
+    parser.add_argument("--check", action="store_true", help="fail if a generated file is out of date")
+    args = parser.parse_args()
+
+    messages = json.loads(SCHEMA_PATH.read_text())["messages"]
+
+    try:
+        validate(messages)
+        outputs = {CPP_PATH: generate_cpp(messages), JS_PATH: generate_js(messages)}
+    except SchemaError as error:
+        print(f"protocol.json: {error}", file=sys.stderr)
+        return 1
+
+    stale = [path for path, text in outputs.items() if not path.exists() or path.read_text() != text]
+
+    if args.check:
+        for path in stale:
+            print(f"{path.relative_to(ROOT)} is out of date, run tools/generate_protocol.py.", file=sys.stderr)
+
+        return 1 if stale else 0
+
+    for path in stale:
+        path.write_text(outputs[path])
+        print(f"Wrote {path.relative_to(ROOT)}.")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())